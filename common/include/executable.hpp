@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <isa.hpp>
+#include <reader.hpp>
+
+// Executables (.e) are either one line of space-separated decimal words (the default)
+// or this header followed by size little-endian words. Every word takes 32 bits, whatever
+// wordBits says, so any image can be mapped as is. Binary executables leave out the bss
+// zeroed words that follow the stored ones
+struct ExecutableHeader {
+    char magic[4];
+    uint16_t version;
+    uint16_t wordBits;
+    uint32_t entry;
+    uint32_t size;
+    uint32_t bss;
+    size_t headerSize;
+};
+
+const char EXE_MAGIC[4] = {'S', 'B', 'E', 'X'};
+const uint16_t EXE_VERSION = 1;
+const size_t EXE_HEADER_SIZE = 20;
+
+bool isBinaryExecutable(TextView contents);
+int parseExecutableHeader(TextView contents, ExecutableHeader* header, std::string* errMsg);
+// Decodes an executable of either format already in memory; bss words are not included
+int parseExecutable(TextView contents, std::vector<int>* words, unsigned int* entry, unsigned int* bss, std::string* errMsg,
+                    unsigned int* wordBits = nullptr);
+// Text executables do not record their word width (the simulator reads them), so they
+// are taken to have the build's
+int readExecutable(std::string fileName, std::vector<int>* words, unsigned int* entry, unsigned int* bss, std::string* errMsg,
+                   unsigned int* wordBits = nullptr);
+int writeExecutable(std::string fileName, const std::vector<int>& words, bool binary, unsigned int entry = 0, unsigned int bss = 0,
+                    unsigned int wordBits = WORD_BITS);
@@ -0,0 +1,213 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Width of machine words, chosen per build (cmake -DWORD_BITS=32 for programs over 32K words)
+#ifndef WORD_BITS
+#define WORD_BITS 16
+#endif
+static_assert(WORD_BITS == 16 || WORD_BITS == 32, "words are 16 or 32 bits wide");
+
+// Instruction set of the hypothetical machine, shared by the assembler, the linker and
+// the emulator. Everything here is constexpr, so tables derived from it cost nothing at run time
+namespace isa {
+
+#if WORD_BITS == 32
+typedef int32_t Word;
+#else
+typedef int16_t Word;
+#endif
+
+// Code and bss together must be addressable by a positive word
+const unsigned long ADDRESS_LIMIT = 1ul << (WORD_BITS - 1);
+// Constants may be given signed or as the unsigned value of the same bits
+const long long WORD_MIN = -(1ll << (WORD_BITS - 1));
+const long long WORD_MAX = (1ll << WORD_BITS) - 1;
+
+enum Opcode {
+    INVALID = 0,
+    ADD,
+    SUB,
+    MULT,
+    DIV,
+    JMP,
+    JMPN,
+    JMPP,
+    JMPZ,
+    COPY,
+    LOAD,
+    STORE,
+    INPUT,
+    OUTPUT,
+    STOP,
+    OPCODE_END
+};
+
+// What an operand word holds
+enum OperandKind {
+    NO_OPERAND = 0,
+    READ,   // address of a word that is read
+    WRITE,  // address of a word that is written
+    TARGET  // address execution jumps to
+};
+
+enum Flags {
+    JUMPS = 1,          // may transfer control to its operand
+    ENDS_BLOCK = 2,     // never falls through to the next instruction
+    READS_MEMORY = 4,
+    WRITES_MEMORY = 8
+};
+
+struct Instruction {
+    const char* mnemonic;
+    int opcode;
+    int length;
+    int operands[2];
+    int flags;
+};
+
+// Indexed by opcode
+constexpr Instruction instructions[] = {
+    {"", INVALID, 0, {NO_OPERAND, NO_OPERAND}, 0},
+    {"ADD", ADD, 2, {READ, NO_OPERAND}, READS_MEMORY},
+    {"SUB", SUB, 2, {READ, NO_OPERAND}, READS_MEMORY},
+    {"MULT", MULT, 2, {READ, NO_OPERAND}, READS_MEMORY},
+    {"DIV", DIV, 2, {READ, NO_OPERAND}, READS_MEMORY},
+    {"JMP", JMP, 2, {TARGET, NO_OPERAND}, JUMPS | ENDS_BLOCK},
+    {"JMPN", JMPN, 2, {TARGET, NO_OPERAND}, JUMPS},
+    {"JMPP", JMPP, 2, {TARGET, NO_OPERAND}, JUMPS},
+    {"JMPZ", JMPZ, 2, {TARGET, NO_OPERAND}, JUMPS},
+    {"COPY", COPY, 3, {READ, WRITE}, READS_MEMORY | WRITES_MEMORY},
+    {"LOAD", LOAD, 2, {READ, NO_OPERAND}, READS_MEMORY},
+    {"STORE", STORE, 2, {WRITE, NO_OPERAND}, WRITES_MEMORY},
+    {"INPUT", INPUT, 2, {WRITE, NO_OPERAND}, WRITES_MEMORY},
+    {"OUTPUT", OUTPUT, 2, {READ, NO_OPERAND}, READS_MEMORY},
+    {"STOP", STOP, 1, {NO_OPERAND, NO_OPERAND}, ENDS_BLOCK},
+};
+static_assert(sizeof(instructions) / sizeof(instructions[0]) == OPCODE_END, "one entry per opcode");
+
+constexpr bool isOpcode(int opcode) {
+    return opcode > INVALID && opcode < OPCODE_END;
+}
+
+// Number of words taken by the instruction, 0 for invalid opcodes
+constexpr int length(int opcode) {
+    return isOpcode(opcode) ? instructions[opcode].length : 0;
+}
+
+constexpr bool hasFlag(int opcode, int flag) {
+    return isOpcode(opcode) && (instructions[opcode].flags & flag) != 0;
+}
+
+constexpr bool isJump(int opcode) {
+    return hasFlag(opcode, JUMPS);
+}
+
+constexpr bool endsBlock(int opcode) {
+    return hasFlag(opcode, ENDS_BLOCK);
+}
+
+// Kind of the i-th operand (0-based)
+constexpr int operandKind(int opcode, int i) {
+    return isOpcode(opcode) && i >= 0 && i < instructions[opcode].length - 1 ? instructions[opcode].operands[i] : NO_OPERAND;
+}
+
+// ADD, SUB and MULT wrap around on overflow, computed on unsigned ints so that it is defined
+constexpr int add(int a, int b) {
+    return (int)((unsigned int)a + (unsigned int)b);
+}
+
+constexpr int subtract(int a, int b) {
+    return (int)((unsigned int)a - (unsigned int)b);
+}
+
+constexpr int multiply(int a, int b) {
+    return (int)((unsigned int)a * (unsigned int)b);
+}
+
+// DIV with a nonzero divisor. A divisor of -1 negates with wraparound, so INT_MIN / -1
+// gives INT_MIN instead of trapping; every implementation of DIV follows this rule
+constexpr int divide(int dividend, int divisor) {
+    return divisor == -1 ? (int)(0u - (unsigned int)dividend) : dividend / divisor;
+}
+
+constexpr size_t mnemonicLength(const char* s, size_t n = 0) {
+    return s[n] == '\0' ? n : mnemonicLength(s, n + 1);
+}
+
+constexpr size_t shortestMnemonic(int opcode = ADD) {
+    return opcode == OPCODE_END - 1 ? mnemonicLength(instructions[opcode].mnemonic) :
+           mnemonicLength(instructions[opcode].mnemonic) < shortestMnemonic(opcode + 1) ?
+           mnemonicLength(instructions[opcode].mnemonic) : shortestMnemonic(opcode + 1);
+}
+
+constexpr size_t longestMnemonic(int opcode = ADD) {
+    return opcode == OPCODE_END - 1 ? mnemonicLength(instructions[opcode].mnemonic) :
+           mnemonicLength(instructions[opcode].mnemonic) > longestMnemonic(opcode + 1) ?
+           mnemonicLength(instructions[opcode].mnemonic) : longestMnemonic(opcode + 1);
+}
+
+constexpr size_t SHORTEST_MNEMONIC = shortestMnemonic();
+constexpr size_t LONGEST_MNEMONIC = longestMnemonic();
+
+// Perfect hash of the mnemonics: first and last character plus length
+const unsigned int HASH_SIZE = 32;
+
+constexpr unsigned int hash(const char* s, size_t n) {
+    return ((unsigned char)s[0] + 18 * (unsigned char)s[n - 1] + n) % HASH_SIZE;
+}
+
+constexpr unsigned int hashOf(int opcode) {
+    return hash(instructions[opcode].mnemonic, mnemonicLength(instructions[opcode].mnemonic));
+}
+
+// Opcode whose mnemonic hashes to slot, or INVALID
+constexpr int opcodeAtSlot(unsigned int slot, int opcode = ADD) {
+    return opcode == OPCODE_END ? INVALID :
+           hashOf(opcode) == slot ? opcode : opcodeAtSlot(slot, opcode + 1);
+}
+
+// Adding a mnemonic that collides with another one fails to compile
+constexpr bool collides(int opcode, int other) {
+    return other < OPCODE_END && (hashOf(opcode) == hashOf(other) || collides(opcode, other + 1));
+}
+
+constexpr bool isPerfect(int opcode = ADD) {
+    return opcode == OPCODE_END || (!collides(opcode, opcode + 1) && isPerfect(opcode + 1));
+}
+static_assert(isPerfect(), "mnemonic hash has collisions, adjust isa::hash");
+
+// Hash slot table, generated at compile time from the instruction table
+template <unsigned int N, unsigned int... Slots>
+struct SlotTable : SlotTable<N - 1, N - 1, Slots...> {};
+
+template <unsigned int... Slots>
+struct SlotTable<0, Slots...> {
+    static constexpr unsigned char opcodes[] = {(unsigned char)opcodeAtSlot(Slots)...};
+};
+
+template <unsigned int... Slots>
+constexpr unsigned char SlotTable<0, Slots...>::opcodes[];
+
+// Opcode of the mnemonic (case-sensitive), or INVALID if it is not an instruction
+inline int lookup(const char* s, size_t n) {
+    if (n < SHORTEST_MNEMONIC || n > LONGEST_MNEMONIC) {
+        return INVALID;
+    }
+    int opcode = SlotTable<HASH_SIZE>::opcodes[hash(s, n)];
+    const char* mnemonic = instructions[opcode].mnemonic;
+    for (size_t i = 0; i < n; ++i) {
+        if (mnemonic[i] != s[i]) {
+            return INVALID;
+        }
+    }
+    return mnemonic[n] == '\0' ? opcode : INVALID;
+}
+
+inline int lookup(const std::string& s) {
+    return lookup(s.data(), s.size());
+}
+
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <list>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <isa.hpp>
+
+// Assembled file held in memory: the contents of an .obj, or of an .e when
+// the source has no BEGIN/END (then only code and bss are meaningful)
+struct ObjectModule {
+    std::string name;
+    bool isModule = false;
+    std::list<std::tuple<std::string, int>> useTable;
+    std::list<std::tuple<std::string, int>> definitionTable;
+    std::list<unsigned int> relative;
+    std::vector<int> code;
+    // Words of code that hold instructions, as (start, size) ranges in address order;
+    // the rest of the code is DATA
+    std::vector<std::pair<unsigned int, unsigned int>> text;
+    unsigned int bss = 0;
+    unsigned int wordBits = WORD_BITS;
+};
+
+// Writes the .obj text format read by the linker
+int writeObject(std::string fileName, const ObjectModule& object);
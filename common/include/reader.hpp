@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Non-owning view into a FileReader buffer
+struct TextView {
+    const char* data = nullptr;
+    size_t size = 0;
+
+    TextView() {}
+    TextView(const char* data, size_t size) : data(data), size(size) {}
+
+    const char* begin() const { return data; }
+    const char* end() const { return data + size; }
+    bool empty() const { return size == 0; }
+    std::string str() const { return std::string(data, size); }
+    bool operator==(const char*) const;
+    bool operator!=(const char* s) const { return !(*this == s); }
+};
+
+// Scan helpers, vectorized when SSE2 is available
+const char* scanChar(const char* begin, const char* end, char c);
+const char* scanSpace(const char* begin, const char* end);
+const char* scanNonSpace(const char* begin, const char* end);
+
+// Returns the part of the line before a ';' comment marker
+TextView stripComment(TextView line);
+// Splits a line into tokens separated by spaces and tabs
+std::vector<TextView> splitTokens(TextView line);
+
+class FileReader {
+    private:
+        std::string fileName;
+        const char* buffer = nullptr;
+        size_t bufferSize = 0;
+        const char* cursor = nullptr;
+        bool mapped = false;
+        std::vector<char> fallback;
+        int error = 0;
+    public:
+        FileReader(std::string);
+        FileReader(std::string, std::string);
+        ~FileReader();
+        FileReader(const FileReader&) = delete;
+        FileReader& operator=(const FileReader&) = delete;
+        bool nextLine(TextView*);
+        std::vector<TextView> lines();
+        TextView contents();
+        bool isMapped();
+        int getError();
+};
@@ -1,3 +1,4 @@
+#include <cstdint>
 #include <fstream>
 #include <list>
 #include <sstream>
@@ -5,9 +6,14 @@
 #include <vector>
 #include <regex>
 
+#include <reader.hpp>
+
 bool fileExists(std::string filename);
 std::list<std::string> tokenize(const std::string s);
+std::list<std::string> tokenize(TextView);
 std::string trim(const std::string &str);
 std::string reduce(const std::string &str);
 bool isSuffix(const std::string &str, const std::string &suffix);
 std::vector<std::string> split(const std::string&, char);
+// FNV-1a; contents are only compared with each other, not with untrusted digests
+uint64_t hashContents(TextView);
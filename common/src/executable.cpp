@@ -0,0 +1,159 @@
+#include <executable.hpp>
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+#include <utils.hpp>
+
+static uint32_t readLE(const char* bytes, int n) {
+    uint32_t value = 0;
+    for (int i = n - 1; i >= 0; --i) {
+        value = value << 8 | (unsigned char)bytes[i];
+    }
+    return value;
+}
+
+static void writeLE(std::string* out, uint32_t value, int n) {
+    for (int i = 0; i < n; ++i) {
+        out->push_back((char)(value >> (8 * i)));
+    }
+}
+
+bool isBinaryExecutable(TextView contents) {
+    return contents.size >= sizeof(EXE_MAGIC) && std::memcmp(contents.data, EXE_MAGIC, sizeof(EXE_MAGIC)) == 0;
+}
+
+int parseExecutableHeader(TextView contents, ExecutableHeader* header, std::string* errMsg) {
+    if (!isBinaryExecutable(contents) || contents.size < EXE_HEADER_SIZE) {
+        *errMsg = "not a binary executable";
+        return 1;
+    }
+    std::memcpy(header->magic, contents.data, sizeof(EXE_MAGIC));
+    header->version = readLE(contents.data + 4, 2);
+    header->wordBits = readLE(contents.data + 6, 2);
+    header->entry = readLE(contents.data + 8, 4);
+    header->size = readLE(contents.data + 12, 4);
+    header->bss = readLE(contents.data + 16, 4);
+    header->headerSize = EXE_HEADER_SIZE;
+
+    if (header->version != EXE_VERSION) {
+        *errMsg = "unsupported executable version " + std::to_string(header->version);
+        return 1;
+    }
+    if (header->wordBits != 16 && header->wordBits != 32) {
+        *errMsg = "unsupported word width " + std::to_string(header->wordBits);
+        return 1;
+    }
+    // Anything past the words would show through the zeroed bss when mapped
+    if ((contents.size - header->headerSize) / 4 < header->size) {
+        *errMsg = "executable is truncated";
+        return 1;
+    }
+    if (contents.size != header->headerSize + 4 * (size_t)header->size) {
+        *errMsg = "executable has trailing data";
+        return 1;
+    }
+    if ((uint64_t)header->size + header->bss > UINT32_MAX) {
+        *errMsg = "executable is too large";
+        return 1;
+    }
+    return 0;
+}
+
+int parseExecutable(TextView contents, std::vector<int>* words, unsigned int* entry, unsigned int* bss, std::string* errMsg,
+                    unsigned int* wordBits) {
+    if (isBinaryExecutable(contents)) {
+        ExecutableHeader header;
+        if (parseExecutableHeader(contents, &header, errMsg)) {
+            return 1;
+        }
+        const char* bytes = contents.data + header.headerSize;
+        words->resize(header.size);
+        for (uint32_t i = 0; i < header.size; ++i) {
+            (*words)[i] = (int32_t)readLE(bytes + 4 * i, 4);
+        }
+        *entry = header.entry;
+        *bss = header.bss;
+        if (wordBits) {
+            *wordBits = header.wordBits;
+        }
+        return 0;
+    }
+
+    // Text executable is a single line of space-separated words
+    const char* cursor = contents.begin();
+    while (cursor < contents.end()) {
+        const char* lineEnd = scanChar(cursor, contents.end(), '\n');
+        for (auto token : splitTokens(TextView(cursor, lineEnd - cursor))) {
+            auto word = token.str();
+            char* end;
+            long value = std::strtol(word.c_str(), &end, 10);
+            if (*end != '\0') {
+                *errMsg = "invalid word " + word;
+                return 1;
+            }
+            words->push_back((int)value);
+        }
+        cursor = lineEnd == contents.end() ? lineEnd : lineEnd + 1;
+    }
+    *entry = 0;
+    *bss = 0;
+    if (wordBits) {
+        *wordBits = WORD_BITS;
+    }
+    return 0;
+}
+
+int readExecutable(std::string fileName, std::vector<int>* words, unsigned int* entry, unsigned int* bss, std::string* errMsg,
+                   unsigned int* wordBits) {
+    if (!fileExists(fileName)) {
+        *errMsg = "File " + fileName + " does not exist";
+        return 1;
+    }
+    FileReader exeFile(fileName);
+    if (exeFile.getError()) {
+        *errMsg = "File " + fileName + " could not be read";
+        return 1;
+    }
+
+    if (parseExecutable(exeFile.contents(), words, entry, bss, errMsg, wordBits)) {
+        *errMsg += " in file " + fileName;
+        return 1;
+    }
+    return 0;
+}
+
+int writeExecutable(std::string fileName, const std::vector<int>& words, bool binary, unsigned int entry, unsigned int bss,
+                    unsigned int wordBits) {
+    std::ofstream outFile;
+    outFile.open(fileName, std::ios::binary);
+    if (!outFile.is_open()) {
+        return 1;
+    }
+
+    if (binary) {
+        std::string out(EXE_MAGIC, sizeof(EXE_MAGIC));
+        writeLE(&out, EXE_VERSION, 2);
+        writeLE(&out, wordBits, 2);
+        writeLE(&out, entry, 4);
+        writeLE(&out, words.size(), 4);
+        writeLE(&out, bss, 4);
+        // Words of either width take 32 bits, so the emulator can map the file
+        for (auto word : words) {
+            writeLE(&out, (uint32_t)word, 4);
+        }
+        outFile << out;
+    } else {
+        // Text executables hold every word, zeroed ones included
+        for (auto word : words) {
+            outFile << std::to_string(word) + ' ';
+        }
+        for (unsigned int i = 0; i < bss; ++i) {
+            outFile << "0 ";
+        }
+        outFile << '\n';
+    }
+    outFile.close();
+    return outFile.fail();
+}
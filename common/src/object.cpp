@@ -0,0 +1,55 @@
+#include <object.hpp>
+
+#include <fstream>
+
+int writeObject(std::string fileName, const ObjectModule& object) {
+    std::ofstream outFile(fileName);
+    if (!outFile.is_open()) {
+        return 1;
+    }
+
+    // Objects of 32-bit builds say so; objects without a WORD section have 16-bit words
+    if (object.wordBits != 16) {
+        outFile << "WORD\n" + std::to_string(object.wordBits) + '\n';
+    }
+
+    // Write TABLE USE section to object file
+    outFile << "TABLE USE\n";
+    for (auto use : object.useTable) {
+        outFile << std::get<0>(use) + ' ' + std::to_string(std::get<1>(use)) + '\n';
+    }
+
+    // Write TABLE DEFINITION section to object file
+    outFile << "TABLE DEFINITION\n";
+    for (auto def : object.definitionTable) {
+        outFile << std::get<0>(def) + ' ' + std::to_string(std::get<1>(def)) + '\n';
+    }
+
+    // Write RELATIVE section to object file
+    outFile << "RELATIVE\n";
+    for (auto rel : object.relative) {
+        outFile << std::to_string(rel) + ' ';
+    }
+    if (!object.relative.empty()) outFile << '\n';
+
+    // Write BSS section (size of the zeroed words after the code) to object file
+    if (object.bss > 0) {
+        outFile << "BSS\n" + std::to_string(object.bss) + '\n';
+    }
+
+    // Write TEXT section (ranges of code words that are instructions) to object file
+    outFile << "TEXT\n";
+    for (auto range : object.text) {
+        outFile << std::to_string(range.first) + ' ' + std::to_string(range.second) + '\n';
+    }
+
+    // Write CODE section to object file
+    outFile << "CODE\n";
+    for (auto code : object.code) {
+        outFile << std::to_string(code) + " ";
+    }
+    if (!object.code.empty()) outFile << '\n';
+
+    outFile.close();
+    return outFile.fail() ? 1 : 0;
+}
@@ -0,0 +1,170 @@
+#include <reader.hpp>
+
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+bool TextView::operator==(const char* s) const {
+    return std::strlen(s) == size && std::memcmp(data, s, size) == 0;
+}
+
+static inline bool isBlank(char c) {
+    return c == ' ' || c == '\t';
+}
+
+const char* scanChar(const char* begin, const char* end, char c) {
+#ifdef __SSE2__
+    const __m128i needle = _mm_set1_epi8(c);
+    while (end - begin >= 16) {
+        __m128i block = _mm_loadu_si128((const __m128i*)begin);
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, needle));
+        if (mask) return begin + __builtin_ctz(mask);
+        begin += 16;
+    }
+#endif
+    while (begin != end && *begin != c) ++begin;
+    return begin;
+}
+
+#ifdef __SSE2__
+// Bit i is set when byte i of the block is a space or a tab
+static inline int blankMask(const char* p) {
+    __m128i block = _mm_loadu_si128((const __m128i*)p);
+    __m128i spaces = _mm_cmpeq_epi8(block, _mm_set1_epi8(' '));
+    __m128i tabs = _mm_cmpeq_epi8(block, _mm_set1_epi8('\t'));
+    return _mm_movemask_epi8(_mm_or_si128(spaces, tabs));
+}
+#endif
+
+const char* scanSpace(const char* begin, const char* end) {
+#ifdef __SSE2__
+    while (end - begin >= 16) {
+        int mask = blankMask(begin);
+        if (mask) return begin + __builtin_ctz(mask);
+        begin += 16;
+    }
+#endif
+    while (begin != end && !isBlank(*begin)) ++begin;
+    return begin;
+}
+
+const char* scanNonSpace(const char* begin, const char* end) {
+#ifdef __SSE2__
+    while (end - begin >= 16) {
+        int mask = ~blankMask(begin) & 0xffff;
+        if (mask) return begin + __builtin_ctz(mask);
+        begin += 16;
+    }
+#endif
+    while (begin != end && isBlank(*begin)) ++begin;
+    return begin;
+}
+
+TextView stripComment(TextView line) {
+    auto commentPos = scanChar(line.begin(), line.end(), ';');
+    return TextView(line.data, commentPos - line.data);
+}
+
+std::vector<TextView> splitTokens(TextView line) {
+    std::vector<TextView> tokens;
+    auto it = scanNonSpace(line.begin(), line.end());
+    while (it != line.end()) {
+        auto tokenEnd = scanSpace(it, line.end());
+        tokens.push_back(TextView(it, tokenEnd - it));
+        it = scanNonSpace(tokenEnd, line.end());
+    }
+    return tokens;
+}
+
+FileReader::FileReader(std::string fileName) {
+    this->fileName = fileName;
+    int fd = open(fileName.c_str(), O_RDONLY);
+    if (fd < 0) {
+        error = 1;
+        return;
+    }
+
+    // Map regular files straight into memory
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void* addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr != MAP_FAILED) {
+            madvise(addr, st.st_size, MADV_SEQUENTIAL);
+            buffer = (const char*)addr;
+            bufferSize = st.st_size;
+            mapped = true;
+        }
+    }
+
+    // Pipes, terminals and anything else mmap refuses are read in large blocks
+    if (!mapped) {
+        const size_t blockSize = 1 << 16;
+        size_t used = 0;
+        ssize_t n;
+        do {
+            fallback.resize(used + blockSize);
+            n = read(fd, fallback.data() + used, blockSize);
+            if (n > 0) used += n;
+        } while (n > 0);
+        if (n < 0) error = 1;
+        fallback.resize(used);
+        buffer = fallback.data();
+        bufferSize = used;
+    }
+    close(fd);
+
+    cursor = buffer;
+}
+
+FileReader::FileReader(std::string fileName, std::string contents) {
+    // Text already in memory (e.g. read from stdin) is served the same way as a file
+    this->fileName = fileName;
+    fallback.assign(contents.begin(), contents.end());
+    buffer = fallback.data();
+    bufferSize = fallback.size();
+    cursor = buffer;
+}
+
+FileReader::~FileReader() {
+    if (mapped) {
+        munmap((void*)buffer, bufferSize);
+    }
+}
+
+bool FileReader::nextLine(TextView* line) {
+    const char* end = buffer + bufferSize;
+    if (cursor == nullptr || cursor == end) {
+        return false;
+    }
+    auto lineEnd = scanChar(cursor, end, '\n');
+    *line = TextView(cursor, lineEnd - cursor);
+    cursor = (lineEnd == end) ? end : lineEnd + 1;
+    return true;
+}
+
+std::vector<TextView> FileReader::lines() {
+    std::vector<TextView> result;
+    TextView line;
+    while (nextLine(&line)) {
+        result.push_back(line);
+    }
+    return result;
+}
+
+TextView FileReader::contents() {
+    return TextView(buffer, bufferSize);
+}
+
+bool FileReader::isMapped() {
+    return mapped;
+}
+
+int FileReader::getError() {
+    return error;
+}
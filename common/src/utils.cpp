@@ -23,6 +23,20 @@ std::list<std::string> tokenize(const std::string s)
    return tokens;
 }
 
+std::list<std::string> tokenize(TextView line)
+{
+   std::list<std::string> tokens;
+   for (auto tokenView : splitTokens(line))
+   {
+      std::string token = tokenView.str();
+      for(auto &c : token) {
+          c = std::toupper(c);
+      }
+      tokens.push_back(token);
+   }
+   return tokens;
+}
+
 std::string trim(const std::string& str)
 {
     const auto strBegin = str.find_first_not_of(" \t");
@@ -73,3 +87,11 @@ std::vector<std::string> split(const std::string& s, char delimiter)
    }
    return tokens;
 }
+
+uint64_t hashContents(TextView contents) {
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < contents.size; ++i) {
+        hash = (hash ^ (unsigned char)contents.data[i]) * 1099511628211ull;
+    }
+    return hash;
+}
@@ -6,4 +6,12 @@ cd build
 cmake ..
 make && \
 mv montador.out ../ && \
-mv ligador.out ../
+mv ligador.out ../ && \
+mv emulador.out ../ && \
+mv conversor.out ../ && \
+mv executor.out ../ && \
+mv rastreador.out ../ && \
+mv depurador.out ../ && \
+mv tradutor.out ../ && \
+mv desempenho.out ../ && \
+mv servidor.out ../
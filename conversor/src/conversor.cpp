@@ -0,0 +1,57 @@
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <executable.hpp>
+#include <utils.hpp>
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        std::cout << "Missing arguments! Expecting 2:" << std::endl
+        << "Usage: conversor [--text | --binary] <input-executable> <output-executable>" << std::endl;
+        return -1;
+    }
+
+    // Without an explicit format, the executable is converted to the other one
+    int format = -1;
+    std::vector<std::string> fileNames;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = std::string(argv[i]);
+        if (arg == "--text") {
+            format = 0;
+        } else if (arg == "--binary") {
+            format = 1;
+        } else {
+            fileNames.push_back(isSuffix(arg, ".e") ? arg : arg + ".e");
+        }
+    }
+    if (fileNames.size() != 2) {
+        std::cout << "Expecting one input and one output executable" << std::endl;
+        return -1;
+    }
+
+    std::vector<int> words;
+    unsigned int entry;
+    unsigned int bss;
+    unsigned int wordBits;
+    std::string errMsg;
+    if (readExecutable(fileNames[0], &words, &entry, &bss, &errMsg, &wordBits)) {
+        std::cout << errMsg << std::endl;
+        return -1;
+    }
+    if (format < 0) {
+        FileReader input(fileNames[0]);
+        format = isBinaryExecutable(input.contents()) ? 0 : 1;
+    }
+    if (format == 0 && entry != 0) {
+        std::cout << "text executables must start at address 0" << std::endl;
+        return -1;
+    }
+
+    if (writeExecutable(fileNames[1], words, format == 1, entry, bss, wordBits)) {
+        std::cout << "could not write " << fileNames[1] << std::endl;
+        return -1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,220 @@
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <list>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+
+#include <emulator.hpp>
+#include <linker.hpp>
+
+// Public symbols of the linked modules, when their .obj files are around
+static std::map<std::string, unsigned int> symbols;
+static std::map<unsigned int, std::string> symbolAt;
+
+static void loadSymbols(std::list<std::string> moduleNames) {
+    for (auto name : moduleNames) {
+        if (!fileExists(name + ".obj")) {
+            return;
+        }
+    }
+    Linker linker(moduleNames);
+    if (linker.parseTables() || linker.link()) {
+        return;
+    }
+    symbols = linker.getSymbols();
+    for (auto kvPair : symbols) {
+        symbolAt[kvPair.second] = kvPair.first;
+    }
+}
+
+// Address, or address and the symbol defined there
+static std::string location(unsigned int addr) {
+    auto it = symbolAt.find(addr);
+    return it == symbolAt.end() ? std::to_string(addr) : std::to_string(addr) + " <" + it->second + ">";
+}
+
+// Parses ADDR, LABEL or LABEL+OFFSET
+static bool parseLocation(std::string arg, unsigned int* addr) {
+    std::string label = arg;
+    unsigned int offset = 0;
+    auto plus = arg.find('+');
+    if (plus != std::string::npos) {
+        label = arg.substr(0, plus);
+        char* end;
+        offset = std::strtoul(arg.c_str() + plus + 1, &end, 10);
+        if (*end != '\0') return false;
+    }
+    if (symbols.count(label) > 0) {
+        *addr = symbols[label] + offset;
+        return true;
+    }
+    char* end;
+    *addr = std::strtoul(arg.c_str(), &end, 10);
+    return !arg.empty() && *end == '\0';
+}
+
+static std::string disassemble(Emulator& emulator, unsigned int addr) {
+    int opcode;
+    if (emulator.readWord(addr, &opcode) || !isa::isOpcode(opcode)) {
+        return "?";
+    }
+    std::string text = isa::instructions[opcode].mnemonic;
+    for (int i = 1; i < isa::length(opcode); ++i) {
+        int operand;
+        if (emulator.readWord(addr + i, &operand)) {
+            return text + " ?";
+        }
+        auto it = symbolAt.find(operand);
+        text += i == 1 ? " " : ", ";
+        text += it == symbolAt.end() ? std::to_string(operand) : it->second;
+    }
+    return text;
+}
+
+static void printPosition(Emulator& emulator) {
+    std::cout << "pc " << location(emulator.getPc()) << ": " << disassemble(emulator, emulator.getPc())
+              << "  acc " << emulator.getAccumulator() << std::endl;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cout << "Missing arguments! Expecting at least 1:" << std::endl
+        << "Usage: depurador [-x <script-file>] [-i <input-file>] <executable-without-extension> ...[linked-modules]" << std::endl;
+        return -1;
+    }
+
+    std::list<std::string> moduleNames;
+    std::string scriptName;
+    std::string inputName;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = std::string(argv[i]);
+        if (arg == "-x" && i + 1 < argc) {
+            scriptName = argv[++i];
+        } else if (arg == "-i" && i + 1 < argc) {
+            inputName = argv[++i];
+        } else {
+            moduleNames.push_back(isSuffix(arg, ".e") ? arg.substr(0, arg.size() - 2) : arg);
+        }
+    }
+    if (moduleNames.empty()) {
+        std::cout << "No executable to debug" << std::endl;
+        return -1;
+    }
+
+    auto image = std::make_shared<Image>(moduleNames.front() + ".e");
+    if (image->getError()) {
+        std::cout << image->getErrorMessage() << std::endl;
+        return -1;
+    }
+    loadSymbols(moduleNames);
+
+    Emulator emulator(image);
+    if (!inputName.empty() && emulator.setInput(inputName, false)) {
+        std::cout << emulator.getErrorMessage() << std::endl;
+        return -1;
+    }
+
+    // Commands come from the script, or from stdin (shared with INPUT when no -i is given)
+    std::ifstream script;
+    if (!scriptName.empty()) {
+        script.open(scriptName);
+        if (!script.is_open()) {
+            std::cout << "could not open script " << scriptName << std::endl;
+            return -1;
+        }
+    }
+    std::istream& commands = scriptName.empty() ? std::cin : script;
+    bool prompt = scriptName.empty() && isatty(STDIN_FILENO);
+
+    // Values of watched words when last reported
+    std::map<unsigned int, int> watched;
+    std::string line;
+    while (true) {
+        if (prompt) {
+            std::cout << "(sb) " << std::flush;
+        }
+        if (!std::getline(commands, line)) break;
+        std::istringstream tokens(line);
+        std::string command, arg;
+        tokens >> command >> arg;
+        if (command.empty() || command[0] == '#') continue;
+
+        unsigned int addr = 0;
+        bool hasLocation = !arg.empty() && parseLocation(arg, &addr);
+        if (command == "break" || command == "b" || command == "delete" || command == "d") {
+            bool enable = command[0] == 'b';
+            if (!hasLocation || emulator.setBreakpoint(addr, enable)) {
+                std::cout << "invalid location " << arg << std::endl;
+                continue;
+            }
+            std::cout << (enable ? "breakpoint at " : "deleted breakpoint at ") << location(addr) << std::endl;
+        } else if (command == "watch" || command == "w" || command == "unwatch") {
+            bool enable = command[0] == 'w';
+            if (!hasLocation || emulator.setWatchpoint(addr, enable)) {
+                std::cout << "invalid location " << arg << std::endl;
+                continue;
+            }
+            if (enable) {
+                emulator.readWord(addr, &watched[addr]);
+            } else {
+                watched.erase(addr);
+            }
+            std::cout << (enable ? "watching " : "stopped watching ") << location(addr) << std::endl;
+        } else if (command == "run" || command == "r" || command == "continue" || command == "c" ||
+                   command == "step" || command == "s") {
+            if (!emulator.isRunning()) {
+                std::cout << "program is not running" << std::endl;
+                continue;
+            }
+            unsigned long count = command[0] == 's' ? (arg.empty() ? 1 : std::strtoul(arg.c_str(), nullptr, 10)) : ULONG_MAX;
+            if (emulator.resume(count)) {
+                std::cout << "simulation error: " + emulator.getErrorMessage() << std::endl;
+                continue;
+            }
+            if (!emulator.isRunning()) {
+                std::cout << "program stopped after " << emulator.getInstructionCount() << " instructions" << std::endl;
+                continue;
+            }
+            if (emulator.getStopReason() == Emulator::STOP_BREAKPOINT) {
+                std::cout << "breakpoint: ";
+            } else if (emulator.getStopReason() == Emulator::STOP_WATCHPOINT) {
+                unsigned int watchAddr = emulator.getWatchAddress();
+                int value;
+                emulator.readWord(watchAddr, &value);
+                std::cout << "watchpoint " << location(watchAddr) << ": " << watched[watchAddr] << " -> " << value << std::endl;
+                watched[watchAddr] = value;
+            }
+            printPosition(emulator);
+        } else if (command == "print" || command == "p") {
+            if (!hasLocation) {
+                std::cout << "invalid location " << arg << std::endl;
+                continue;
+            }
+            unsigned long count = 1;
+            tokens >> count;
+            for (unsigned long i = 0; i < count; ++i) {
+                int value;
+                if (emulator.readWord(addr + i, &value)) break;
+                std::cout << location(addr + i) << ": " << value << std::endl;
+            }
+        } else if (command == "info" || command == "i") {
+            printPosition(emulator);
+            std::cout << emulator.getInstructionCount() << " instructions executed" << std::endl;
+        } else if (command == "symbols") {
+            for (auto kvPair : symbolAt) {
+                std::cout << kvPair.first << " " << kvPair.second << std::endl;
+            }
+        } else if (command == "quit" || command == "q") {
+            break;
+        } else {
+            std::cout << "commands: break|b, delete|d, watch|w, unwatch <addr|label[+n]>;"
+                      << " run|r, continue|c, step|s [n]; print|p <addr|label[+n]> [count]; info|i; symbols; quit|q" << std::endl;
+        }
+    }
+
+    return 0;
+}
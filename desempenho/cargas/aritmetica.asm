@@ -0,0 +1,22 @@
+; Núcleo de aritmética: ADD, SUB, MULT e DIV em laço, N vezes
+SECTION TEXT
+        INPUT   N
+LACO:   LOAD    X
+        ADD     UM
+        MULT    TRES
+        DIV     DOIS
+        SUB     X
+        STORE   X
+        LOAD    N
+        SUB     UM
+        STORE   N
+        JMPP    LACO
+        OUTPUT  X
+        STOP
+SECTION DATA
+UM:     CONST   1
+DOIS:   CONST   2
+TRES:   CONST   3
+SECTION BSS
+N:      SPACE
+X:      SPACE
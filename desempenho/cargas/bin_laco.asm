@@ -0,0 +1,24 @@
+; test-files/bin.asm em laço: converte para binário cada valor lido até ler zero
+SECTION TEXT
+LACO:   INPUT   OLD_DATA
+        LOAD    OLD_DATA
+        JMPZ    FIM
+L1:     DIV     DOIS
+        STORE   NEW_DATA
+        MULT    DOIS
+        STORE   TMP_DATA
+        LOAD    OLD_DATA
+        SUB     TMP_DATA
+        STORE   TMP_DATA
+        OUTPUT  TMP_DATA
+        COPY    NEW_DATA, OLD_DATA
+        LOAD    OLD_DATA
+        JMPP    L1
+        JMP     LACO
+FIM:    STOP
+SECTION DATA
+DOIS:   CONST   2
+SECTION BSS
+OLD_DATA: SPACE
+NEW_DATA: SPACE
+TMP_DATA: SPACE
@@ -0,0 +1,15 @@
+; Núcleo de entrada e saída: lê N e depois ecoa N valores
+SECTION TEXT
+        INPUT   N
+LACO:   INPUT   X
+        OUTPUT  X
+        LOAD    N
+        SUB     UM
+        STORE   N
+        JMPP    LACO
+        STOP
+SECTION DATA
+UM:     CONST   1
+SECTION BSS
+N:      SPACE
+X:      SPACE
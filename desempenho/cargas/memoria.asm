@@ -0,0 +1,21 @@
+; Núcleo de memória: LOAD, STORE e COPY em laço, N vezes
+SECTION TEXT
+        INPUT   N
+LACO:   COPY    A, B
+        COPY    B, C
+        LOAD    C
+        ADD     UM
+        STORE   A
+        LOAD    N
+        SUB     UM
+        STORE   N
+        JMPP    LACO
+        OUTPUT  A
+        STOP
+SECTION DATA
+UM:     CONST   1
+SECTION BSS
+N:      SPACE
+A:      SPACE
+B:      SPACE
+C:      SPACE
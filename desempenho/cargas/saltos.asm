@@ -0,0 +1,18 @@
+; Núcleo de desvios: JMP, JMPN, JMPP e JMPZ em laço, N vezes
+SECTION TEXT
+        INPUT   N
+LACO:   LOAD    N
+        JMPZ    FIM
+        JMPN    FIM
+        JMP     PASSO
+PASSO:  SUB     UM
+        JMPP    VOLTA
+        JMP     FIM
+VOLTA:  STORE   N
+        JMP     LACO
+FIM:    OUTPUT  N
+        STOP
+SECTION DATA
+UM:     CONST   1
+SECTION BSS
+N:      SPACE
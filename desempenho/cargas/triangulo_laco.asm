@@ -0,0 +1,22 @@
+; test-files/triangulo.asm em laço: lê base e altura até a base ser zero
+TRIANGULO: EQU 1
+
+SECTION TEXT
+LACO:   INPUT   B
+        LOAD    B
+        JMPZ    FIM
+        INPUT   H
+        LOAD    B
+        MULT    H
+        IF TRIANGULO
+        DIV     DOIS
+        STORE   R
+        OUTPUT  R
+        JMP     LACO
+FIM:    STOP
+SECTION BSS
+B:      SPACE
+H:      SPACE
+R:      SPACE
+SECTION DATA
+DOIS:   CONST   0x02
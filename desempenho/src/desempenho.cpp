@@ -0,0 +1,322 @@
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <assembler.hpp>
+#include <emulator.hpp>
+#include <linker.hpp>
+#include <preprocessor.hpp>
+
+// Program run by the benchmark; size sets how much work one run does, times --scale
+struct Workload {
+    const char* name;
+    std::vector<std::string> sources;
+    unsigned long size;
+    std::vector<int> (*inputs)(unsigned long);
+};
+
+static std::vector<int> countInput(unsigned long size) {
+    return {(int)size};
+}
+
+static std::vector<int> echoInput(unsigned long size) {
+    std::vector<int> values = {(int)size};
+    for (unsigned long i = 0; i < size; ++i) {
+        values.push_back((int)(i % 1000) - 500);
+    }
+    return values;
+}
+
+// Base and height pairs, ended by a zero base
+static std::vector<int> triangleInput(unsigned long size) {
+    std::vector<int> values;
+    for (unsigned long i = 0; i < size; ++i) {
+        values.push_back((int)(i % 97) + 1);
+        values.push_back((int)(i % 89) + 2);
+    }
+    values.push_back(0);
+    return values;
+}
+
+// Positive values of up to 15 bits, ended by a zero
+static std::vector<int> binaryInput(unsigned long size) {
+    std::vector<int> values;
+    for (unsigned long i = 0; i < size; ++i) {
+        values.push_back((int)((i * 7919) % 32767) + 1);
+    }
+    values.push_back(0);
+    return values;
+}
+
+static const Workload workloads[] = {
+    {"aritmetica", {"desempenho/cargas/aritmetica"}, 1000000, countInput},
+    {"memoria", {"desempenho/cargas/memoria"}, 1000000, countInput},
+    {"saltos", {"desempenho/cargas/saltos"}, 1250000, countInput},
+    {"es", {"desempenho/cargas/es"}, 1000000, echoInput},
+    {"triangulo", {"desempenho/cargas/triangulo_laco"}, 750000, triangleInput},
+    {"bin", {"desempenho/cargas/bin_laco"}, 50000, binaryInput},
+    {"projeto", {"big-project/main", "big-project/fat", "big-project/math", "big-project/gauss_sum",
+                 "big-project/class_variables"}, 500000, countInput},
+};
+
+struct Result {
+    std::string name;
+    unsigned long instructions = 0;
+    unsigned int runs = 0;
+    double best = 0;
+    double mean = 0;
+    unsigned long outputs = 0;
+    uint32_t checksum = 0;
+    std::vector<unsigned long> mix = std::vector<unsigned long>(isa::OPCODE_END, 0);
+};
+
+// Assembles and links the sources in memory, as the executor does, into an image's words
+static int build(std::string dir, const Workload& workload, std::vector<int>* words) {
+    std::list<ObjectModule> objects;
+    for (auto source : workload.sources) {
+        std::unique_ptr<PreProcessor> pp(new PreProcessor(dir + "/" + source));
+        if (pp->getError() || pp->preProcess()) {
+            return 1;
+        }
+        Assembler assembler(source, pp->getOutput());
+        assembler.setIncludedFiles(pp->getIncludedFiles());
+        if (assembler.firstPass() || assembler.secondPass()) {
+            std::cout << source << ": " << assembler.getErrorMessage() << std::endl;
+            return 1;
+        }
+        objects.push_back(assembler.getObject());
+    }
+
+    unsigned int bss;
+    if (objects.size() == 1 && !objects.front().isModule) {
+        *words = objects.front().code;
+        bss = objects.front().bss;
+    } else {
+        Linker linker(workload.name, objects);
+        if (linker.parseTables() || linker.link()) {
+            std::cout << linker.getErrorMessage();
+            return 1;
+        }
+        *words = linker.getCode();
+        bss = linker.getBss();
+    }
+    words->resize(words->size() + bss, 0);
+    return 0;
+}
+
+// Feeds the inputs and folds the outputs into a count and a checksum
+static void connect(Emulator& emulator, const std::vector<int>& inputs, Result* result) {
+    size_t next = 0;
+    emulator.setInputCallback([&inputs, next](int* value) mutable {
+        if (next >= inputs.size()) return false;
+        *value = inputs[next++];
+        return true;
+    });
+    result->outputs = 0;
+    result->checksum = 0;
+    emulator.setOutputCallback([result](int value) {
+        ++result->outputs;
+        result->checksum = result->checksum * 31 + (uint32_t)value;
+    });
+}
+
+static int measure(std::string dir, const Workload& workload, unsigned long scale, unsigned int repeat,
+                   bool fusion, bool mix, Result* result) {
+    result->name = workload.name;
+    std::vector<int> words;
+    if (build(dir, workload, &words)) {
+        std::cout << workload.name << ": could not build" << std::endl;
+        return 1;
+    }
+    std::vector<int> inputs = workload.inputs(workload.size * scale);
+
+    // Image preparation is done once and left out of the timings
+    auto image = std::make_shared<Image>(words);
+    if (fusion) {
+        image->fuse();
+    }
+    image->verify();
+
+    double total = 0;
+    for (unsigned int run = 0; run < repeat; ++run) {
+        Emulator emulator(image);
+        connect(emulator, inputs, result);
+        auto start = std::chrono::steady_clock::now();
+        int err = emulator.run();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        if (err) {
+            std::cout << workload.name << ": simulation error: " << emulator.getErrorMessage() << std::endl;
+            return 1;
+        }
+        result->instructions = emulator.getInstructionCount();
+        total += elapsed.count();
+        if (run == 0 || elapsed.count() < result->best) {
+            result->best = elapsed.count();
+        }
+    }
+    result->runs = repeat;
+    result->mean = total / repeat;
+
+    // Opcode mix comes from a separate stepped run of the unfused image, so it costs the
+    // timed runs nothing
+    if (mix) {
+        auto plain = std::make_shared<Image>(words);
+        Emulator emulator(plain);
+        Result ignored;
+        connect(emulator, inputs, &ignored);
+        while (emulator.isRunning()) {
+            int opcode;
+            if (emulator.readWord(emulator.getPc(), &opcode) == 0 && isa::isOpcode(opcode)) {
+                ++result->mix[opcode];
+            }
+            if (emulator.resume(1)) {
+                std::cout << workload.name << ": simulation error: " << emulator.getErrorMessage() << std::endl;
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+static double ips(const Result& result) {
+    return result.best > 0 ? result.instructions / result.best : 0;
+}
+
+#ifdef __OPTIMIZE__
+static const bool optimized = true;
+#else
+static const bool optimized = false;
+#endif
+
+// Keys and opcodes always come in the same order, so results of two builds diff cleanly
+static void writeJson(std::ostream& out, const std::vector<Result>& results, unsigned long scale, unsigned int repeat,
+                      bool fusion, bool mix) {
+    out << std::setprecision(9)
+        << "{\n  \"format\": 1,\n"
+        << "  \"build\": {\"wordBits\": " << WORD_BITS << ", \"optimized\": " << (optimized ? "true" : "false") << "},\n"
+        << "  \"scale\": " << scale << ",\n  \"repeat\": " << repeat << ",\n"
+        << "  \"fusion\": " << (fusion ? "true" : "false") << ",\n  \"workloads\": [";
+    for (size_t i = 0; i < results.size(); ++i) {
+        auto& result = results[i];
+        out << (i > 0 ? "," : "") << "\n    {\n"
+            << "      \"name\": \"" << result.name << "\",\n"
+            << "      \"instructions\": " << result.instructions << ",\n"
+            << "      \"runs\": " << result.runs << ",\n"
+            << "      \"seconds\": " << result.best << ",\n"
+            << "      \"meanSeconds\": " << result.mean << ",\n"
+            << "      \"ips\": " << (unsigned long)ips(result) << ",\n"
+            << "      \"outputs\": " << result.outputs << ",\n"
+            << "      \"checksum\": " << result.checksum;
+        if (mix) {
+            out << ",\n      \"mix\": {";
+            for (int opcode = 1; opcode < isa::OPCODE_END; ++opcode) {
+                out << (opcode > 1 ? ", " : "") << "\"" << isa::instructions[opcode].mnemonic << "\": " << result.mix[opcode];
+            }
+            out << "}";
+        }
+        out << "\n    }";
+    }
+    out << "\n  ]\n}\n";
+}
+
+int main(int argc, char** argv) {
+    std::string dir = ".";
+    std::string jsonName;
+    unsigned long scale = 1;
+    unsigned int repeat = 3;
+    bool fusion = true;
+    bool mix = true;
+    std::list<std::string> selected;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = std::string(argv[i]);
+        if (arg == "--dir" && i + 1 < argc) {
+            dir = argv[++i];
+        } else if (arg == "--json" && i + 1 < argc) {
+            jsonName = argv[++i];
+        } else if (arg == "--scale" && i + 1 < argc) {
+            scale = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--repeat" && i + 1 < argc) {
+            repeat = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--no-fusion") {
+            fusion = false;
+        } else if (arg == "--no-mix") {
+            mix = false;
+        } else if (arg == "--require-optimized") {
+            // Timings of an unoptimized build say little about the emulator
+            if (!optimized) {
+                std::cout << "desempenho was built without optimization; configure with -DCMAKE_BUILD_TYPE=Release" << std::endl;
+                return -1;
+            }
+        } else if (arg == "--list") {
+            for (auto& workload : workloads) {
+                std::cout << workload.name << std::endl;
+            }
+            return 0;
+        } else if (arg[0] == '-') {
+            std::cout << "Usage: desempenho [--dir <repository>] [--json <results-file>] [--scale <n>] [--repeat <n>]"
+                      << " [--no-fusion] [--no-mix] [--require-optimized] [--list] ...[workloads]" << std::endl;
+            return -1;
+        } else {
+            selected.push_back(arg);
+        }
+    }
+    if (scale == 0 || repeat == 0) {
+        std::cout << "--scale and --repeat must be positive" << std::endl;
+        return -1;
+    }
+    for (auto name : selected) {
+        bool known = false;
+        for (auto& workload : workloads) {
+            known = known || name == workload.name;
+        }
+        if (!known) {
+            std::cout << "unknown workload " << name << std::endl;
+            return -1;
+        }
+    }
+
+    std::vector<Result> results;
+    for (auto& workload : workloads) {
+        bool wanted = selected.empty();
+        for (auto name : selected) {
+            wanted = wanted || name == workload.name;
+        }
+        if (!wanted) continue;
+
+        Result result;
+        if (measure(dir, workload, scale, repeat, fusion, mix, &result)) {
+            return -1;
+        }
+        std::cout << std::left << std::setw(12) << result.name << std::right
+                  << std::setw(12) << result.instructions << " instructions "
+                  << std::fixed << std::setprecision(4) << std::setw(9) << result.best << " s "
+                  << std::setprecision(1) << std::setw(8) << ips(result) / 1e6 << " M/s" << std::endl;
+        if (mix) {
+            std::cout << "            ";
+            for (int opcode = 1; opcode < isa::OPCODE_END; ++opcode) {
+                if (result.mix[opcode] == 0) continue;
+                std::cout << " " << isa::instructions[opcode].mnemonic << " "
+                          << std::setprecision(1) << 100.0 * result.mix[opcode] / result.instructions << "%";
+            }
+            std::cout << std::endl;
+        }
+        results.push_back(result);
+    }
+
+    if (!jsonName.empty()) {
+        std::ofstream jsonFile(jsonName);
+        writeJson(jsonFile, results, scale, repeat, fusion, mix);
+        jsonFile.close();
+        if (jsonFile.fail()) {
+            std::cout << "could not write " << jsonName << std::endl;
+            return -1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+// Source of INPUT values: the console, a callback, or a file/pipe read in large
+// blocks. Binary channels carry 32-bit little-endian words instead of decimal text
+class InputChannel {
+    private:
+        int fd = -1;
+        bool console = true;
+        bool binary = false;
+        std::vector<char> buffer;
+        size_t pos = 0;
+        size_t end = 0;
+        bool eof = false;
+        std::function<bool(int*)> callback;
+        int error = 0;
+        bool fill(size_t);
+    public:
+        InputChannel();
+        ~InputChannel();
+        int open(std::string, bool);
+        void setCallback(std::function<bool(int*)>);
+        bool next(int*);
+        int getError();
+};
+
+// Sink of OUTPUT values: the console, a callback, or a buffer flushed to a file/pipe in large blocks
+class OutputChannel {
+    private:
+        int fd = -1;
+        bool console = true;
+        bool binary = false;
+        std::vector<char> buffer;
+        size_t used = 0;
+        std::function<void(int)> callback;
+        int error = 0;
+        // Last values put, kept for reports on runs that are cut short
+        static const unsigned int RECENT_SIZE = 8;
+        int recent[RECENT_SIZE];
+        unsigned long count = 0;
+    public:
+        OutputChannel();
+        ~OutputChannel();
+        int open(std::string, bool);
+        void setCallback(std::function<void(int)>);
+        void put(int);
+        int flush();
+        // Up to the last RECENT_SIZE values put, oldest first
+        std::vector<int> getRecent();
+        int getError();
+};
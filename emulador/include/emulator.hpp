@@ -0,0 +1,122 @@
+#pragma once
+
+#include <chrono>
+#include <climits>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <channel.hpp>
+#include <handlers.hpp>
+#include <image.hpp>
+#include <trace.hpp>
+#include <utils.hpp>
+
+// One running instance of an Image. Instances keep no global state, so any
+// number of them may run concurrently on different threads
+class Emulator : public Handlers {
+    public:
+        // Why the last resume() returned while the program is still running
+        enum StopReason {
+            STOP_NONE = 0,
+            STOP_BREAKPOINT,
+            STOP_WATCHPOINT
+        };
+        static const unsigned int NO_ADDRESS = UINT_MAX;
+        // Run limit that ended the run, if any
+        enum Limit {
+            LIMIT_NONE = 0,
+            LIMIT_INSTRUCTIONS,
+            LIMIT_TIME,
+            LIMIT_WRITE
+        };
+    private:
+        std::shared_ptr<const Image> image;
+        // Private copy-on-write view of a mapped image, or a copy of its words
+        void* mapping = nullptr;
+        size_t mappingSize = 0;
+        std::vector<int> storage;
+        int* memory = nullptr;
+        unsigned int memorySize = 0;
+        int acc = 0;
+        unsigned int pc = 0;
+        bool running = true;
+        unsigned long instructionCount = 0;
+
+        // Decoded entry per start address, and words covered by any decoded entry
+        // (only allocated when the checked loop runs)
+        DecodedTable decoded = allocateDecoded(0);
+        std::vector<bool> isCode;
+        const unsigned char* fusionStart;
+
+        InputChannel input;
+        OutputChannel output;
+
+        // Debugger state. Entries at breakpoints decode to BREAKPOINT, and watched words are
+        // marked as code so that writes to them take the invalidate() path
+        bool debugging = false;
+        std::vector<bool> isBreakpoint;
+        std::vector<bool> isWatched;
+        unsigned int trapAddr = NO_ADDRESS;
+        unsigned int stepOverAddr = NO_ADDRESS;
+        unsigned int pausedAt = NO_ADDRESS;
+        int stopReason = STOP_NONE;
+        unsigned int watchAddr = 0;
+        void attach();
+
+        // Ring of the last instructions, dumped to traceName on STOP or error
+        std::unique_ptr<Trace> trace;
+        std::string traceName;
+        TraceRecord* traceRecord = nullptr;
+
+        // Limits are checked by run() between slices, never inside the instruction loop
+        unsigned long instructionLimit = ULONG_MAX;
+        double timeLimit = 0;
+        bool started = false;
+        std::chrono::steady_clock::time_point deadline;
+        int limitReached = LIMIT_NONE;
+        int stopAtLimit(int, std::string);
+
+        int error = 0;
+        std::string errMsg;
+        std::string genErrMsg(unsigned int, std::string);
+
+        int decode(unsigned int);
+        void invalidate(unsigned int);
+        template <bool checked, bool traced> void store(unsigned int, int);
+        template <bool checked, bool traced> int execute(unsigned long);
+        int dispatch(unsigned long);
+    public:
+        Emulator(std::shared_ptr<const Image>);
+        ~Emulator();
+        Emulator(const Emulator&) = delete;
+        Emulator& operator=(const Emulator&) = delete;
+        int setInput(std::string, bool);
+        int setOutput(std::string, bool);
+        void setInputCallback(std::function<bool(int*)>);
+        void setOutputCallback(std::function<void(int)>);
+        void setTrace(std::string, uint32_t);
+        const Trace* getTrace();
+        void setInstructionLimit(unsigned long);
+        void setTimeLimit(double);
+        int getLimit();
+        std::vector<int> getLastOutputs();
+        int run();
+        // Like resume(), but stops at the limits; run() and the Scheduler go through it
+        int runSlice(unsigned long);
+        int resume(unsigned long);
+        int setBreakpoint(unsigned int, bool);
+        int setWatchpoint(unsigned int, bool);
+        int getStopReason();
+        unsigned int getWatchAddress();
+        int getAccumulator();
+        unsigned int getPc();
+        unsigned int getMemorySize();
+        int readWord(unsigned int, int*);
+        bool isRunning();
+        unsigned long getInstructionCount();
+        int getError();
+        std::string getErrorMessage();
+};
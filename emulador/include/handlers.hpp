@@ -0,0 +1,68 @@
+#pragma once
+
+#include <memory>
+
+#include <isa.hpp>
+
+// Handlers of decoded instructions, shared by the image loader and the emulator:
+// the opcodes of isa.hpp first, then superinstructions (common opcode pairs and triples)
+struct Handlers {
+    enum {
+        UNDECODED = isa::INVALID,
+        ADD = isa::ADD,
+        SUB = isa::SUB,
+        MULT = isa::MULT,
+        DIV = isa::DIV,
+        JMP = isa::JMP,
+        JMPN = isa::JMPN,
+        JMPP = isa::JMPP,
+        JMPZ = isa::JMPZ,
+        COPY = isa::COPY,
+        LOAD = isa::LOAD,
+        STORE = isa::STORE,
+        INPUT = isa::INPUT,
+        OUTPUT = isa::OUTPUT,
+        STOP = isa::STOP,
+        LOAD_ADD_STORE = isa::OPCODE_END,
+        LOAD_SUB_STORE,
+        LOAD_MULT_STORE,
+        LOAD_ADD,
+        LOAD_SUB,
+        LOAD_MULT,
+        ADD_STORE,
+        SUB_STORE,
+        MULT_STORE,
+        SUB_JMPZ,
+        SUB_JMPP,
+        SUB_JMPN,
+        LOAD_JMPZ,
+        LOAD_JMPP,
+        LOAD_JMPN,
+        COPY_JMP,
+        STORE_LOAD,
+        HANDLER_COUNT,
+        // Not an instruction: patched over entries where the debugger stops
+        BREAKPOINT = HANDLER_COUNT
+    };
+    static const int FIRST_FUSED = LOAD_ADD_STORE;
+    // Longest span of words a decoded entry may cover (LOAD ADD STORE)
+    static const unsigned int MAX_SPAN = 6;
+    struct FusionPattern {
+        int id;
+        int size;
+        int opcodes[3];
+        const char* name;
+    };
+    static const FusionPattern fusionPatterns[];
+    // Pre-decoded instruction: handler, operand addresses and words covered
+    struct Decoded {
+        unsigned char handler;
+        unsigned char length;
+        unsigned int op[3];
+    };
+    // Decoded tables are calloc'ed: UNDECODED is 0, so pages of a large table cost nothing until used
+    typedef std::unique_ptr<Decoded[], void (*)(void*)> DecodedTable;
+    static DecodedTable allocateDecoded(unsigned int);
+    static int instructionLength(int);
+    static bool decodeEntry(const int*, unsigned int, unsigned int, int, Decoded*);
+};
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <executable.hpp>
+#include <handlers.hpp>
+#include <utils.hpp>
+
+// Loaded executable, immutable once prepared and shared by every Emulator running it
+class Image : public Handlers {
+    private:
+        std::string fileName;
+        // Words of a text image are parsed into storage; binary images are mapped read-only
+        std::vector<int> storage;
+        const int* words = nullptr;
+        unsigned int wordCount = 0;
+        unsigned int entry = 0;
+        int fd = -1;
+        void* mapping = nullptr;
+        size_t mappingSize = 0;
+        size_t fileSize = 0;
+        size_t headerSize = 0;
+        void* mapWithBss(int) const;
+
+        // Superinstruction found by the load-time scan at each address
+        std::vector<unsigned char> fusionStart;
+        std::vector<unsigned int> fusedCount;
+
+        // Entries decoded once for every reachable instruction of a verified image
+        bool verified = false;
+        std::string unverifiedReason;
+        DecodedTable code = allocateDecoded(0);
+
+        int error = 0;
+        std::string errMsg;
+
+        std::vector<bool> findInstructionStarts(std::vector<unsigned int>*);
+    public:
+        Image(std::string);
+        // Words already in memory, bss included
+        Image(std::vector<int>, unsigned int entry = 0);
+        ~Image();
+        Image(const Image&) = delete;
+        Image& operator=(const Image&) = delete;
+        int fuse();
+        int printFusion();
+        int verify();
+        bool isVerified() const;
+        std::string getUnverifiedReason();
+        const int* getWords() const;
+        unsigned int getSize() const;
+        unsigned int getEntry() const;
+        int* mapPrivate(void**, size_t*) const;
+        const std::vector<unsigned char>& getFusionStarts() const;
+        const Decoded* getDecoded() const;
+        int getError();
+        std::string getErrorMessage();
+};
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <climits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <emulator.hpp>
+#include <handlers.hpp>
+#include <image.hpp>
+
+// Runs one image over many input vectors, a group of lanes (8 or 16 instances) at a
+// time in lockstep. Lane memories are interleaved word by word (word a of lane l is at
+// a * lanes + l), so the lanes sharing a pc run each instruction as one vector operation.
+// When branches diverge, the lanes at the lowest pc run and the others wait for them;
+// a lane whose instance ends takes the next input vector at once
+class Lockstep : public Handlers {
+    public:
+        // How an instance ended, as a separate Emulator would have ended it
+        struct Result {
+            std::vector<int> outputs;
+            unsigned long instructions = 0;
+            int error = 0;
+            int limit = Emulator::LIMIT_NONE;
+            std::string errMsg;
+        };
+    private:
+        std::shared_ptr<const Image> image;
+        unsigned int lanes;
+        unsigned long instructionLimit = ULONG_MAX;
+        // Plain instructions decoded once for all lanes (verified images never write code)
+        DecodedTable code = allocateDecoded(0);
+        unsigned long steps = 0;
+        unsigned long laneInstructions = 0;
+        template <unsigned int LANES> void execute(const std::vector<std::vector<int>>&, std::vector<Result>*);
+        void runEach(const std::vector<std::vector<int>>&, std::vector<Result>*);
+    public:
+        // Lanes are 8 or 16; 1 (or an image that failed verification) runs one Emulator per input
+        Lockstep(std::shared_ptr<const Image>, unsigned int lanes = 8);
+        void setInstructionLimit(unsigned long);
+        // Results come in the order of the inputs
+        std::vector<Result> run(const std::vector<std::vector<int>>&);
+        // Vector steps run, and instructions they ran over all lanes
+        unsigned long getSteps();
+        unsigned long getLaneInstructions();
+        unsigned int getLanes();
+};
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <emulator.hpp>
+
+// Runs many Emulator instances on a pool of worker threads. Each worker owns a
+// queue of instances and runs them a slice of instructions at a time, putting
+// unfinished ones back at the end of its queue so long programs cannot starve
+// short ones. Idle workers steal from the other end of their peers' queues
+class Scheduler {
+    private:
+        struct Job {
+            Emulator* emulator;
+            std::function<void(Emulator*)> done;
+        };
+        struct WorkerQueue {
+            std::mutex mutex;
+            std::deque<Job> jobs;
+        };
+        unsigned long sliceSize;
+        std::vector<std::unique_ptr<WorkerQueue>> queues;
+        std::vector<std::thread> workers;
+        std::atomic<unsigned int> nextQueue;
+
+        // Jobs sitting in queues, and jobs submitted but not finished yet
+        std::mutex stateMutex;
+        std::condition_variable workAvailable;
+        std::condition_variable allDone;
+        std::atomic<long> queued;
+        long pending = 0;
+        bool stopping = false;
+
+        void push(unsigned int, Job);
+        bool popLocal(unsigned int, Job*);
+        bool steal(unsigned int, Job*);
+        void work(unsigned int);
+    public:
+        Scheduler(unsigned int, unsigned long);
+        ~Scheduler();
+        void submit(Emulator*, std::function<void(Emulator*)>);
+        void wait();
+};
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// One executed (possibly fused) instruction. Every handler writes at most one word,
+// so a single event per record is enough
+struct TraceRecord {
+    uint32_t pc;
+    uint8_t handler;
+    uint8_t event;
+    // Instructions the record stands for: the group length for fused ones, 0 for errors
+    uint16_t instructions;
+    int32_t accDelta;
+    uint32_t addr;
+    int32_t value;
+};
+static_assert(sizeof(TraceRecord) == 20, "trace records are dumped as is");
+
+enum TraceEvent {
+    TRACE_NONE = 0,
+    TRACE_WRITE,    // value stored at addr
+    TRACE_INPUT,    // value read by INPUT and stored at addr
+    TRACE_OUTPUT,   // value at addr written by OUTPUT
+    TRACE_ERROR     // execution stopped with an error at pc
+};
+
+// Trace files are this header followed by the records kept, oldest first, in host
+// byte order (little-endian on every machine we run on)
+struct TraceHeader {
+    char magic[4];
+    uint16_t version;
+    uint16_t recordSize;
+    uint32_t capacity;
+    uint64_t count;         // records committed, kept or not
+    uint64_t instructions;  // instructions those records stand for
+};
+
+const char TRACE_MAGIC[4] = {'S', 'B', 'T', 'R'};
+const uint16_t TRACE_VERSION = 2;
+const size_t TRACE_HEADER_SIZE = 28;
+
+// Fixed-size ring of the last executed instructions; older records are overwritten
+class Trace {
+    private:
+        std::vector<TraceRecord> records;
+        uint64_t count = 0;
+        uint64_t instructions = 0;
+        uint32_t mask;
+    public:
+        // Capacity is rounded up to a power of two
+        Trace(uint32_t);
+        // Slot of the next record, filled in place and kept by commit()
+        TraceRecord* next() {
+            return &records[count & mask];
+        }
+        void commit() {
+            instructions += records[count & mask].instructions;
+            ++count;
+        }
+        uint64_t getCount() const;
+        // Only calls write(), so it may be used from a signal handler
+        int dump(int) const;
+        int dump(std::string) const;
+};
+
+int readTrace(std::string fileName, TraceHeader* header, std::vector<TraceRecord>* records, std::string* errMsg);
@@ -0,0 +1,208 @@
+#include <channel.hpp>
+
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <unistd.h>
+
+static const size_t BLOCK_SIZE = 1 << 16;
+
+InputChannel::InputChannel() {}
+
+InputChannel::~InputChannel() {
+    if (fd > STDIN_FILENO) {
+        close(fd);
+    }
+}
+
+int InputChannel::open(std::string fileName, bool binary) {
+    this->binary = binary;
+    console = false;
+    if (fileName == "-") {
+        fd = STDIN_FILENO;
+    } else {
+        fd = ::open(fileName.c_str(), O_RDONLY);
+        if (fd < 0) {
+            error = 1;
+            return error;
+        }
+    }
+    buffer.resize(BLOCK_SIZE);
+    return 0;
+}
+
+void InputChannel::setCallback(std::function<bool(int*)> callback) {
+    this->callback = callback;
+    console = false;
+}
+
+bool InputChannel::fill(size_t needed) {
+    // Keep the unread tail and read whole blocks after it until enough bytes are buffered
+    if (pos > 0) {
+        std::memmove(buffer.data(), buffer.data() + pos, end - pos);
+        end -= pos;
+        pos = 0;
+    }
+    while (end < needed && !eof) {
+        if (buffer.size() - end < BLOCK_SIZE) {
+            buffer.resize(end + BLOCK_SIZE);
+        }
+        ssize_t n = read(fd, buffer.data() + end, buffer.size() - end);
+        if (n < 0) {
+            error = 1;
+            return false;
+        }
+        if (n == 0) {
+            eof = true;
+        }
+        end += n;
+    }
+    return end >= needed;
+}
+
+bool InputChannel::next(int* value) {
+    if (error) {
+        return false;
+    }
+    if (console) {
+        return (bool)(std::cin >> *value);
+    }
+    if (callback) {
+        return callback(value);
+    }
+
+    if (binary) {
+        if (end - pos < 4 && !fill(4)) {
+            return false;
+        }
+        const unsigned char* bytes = (const unsigned char*)buffer.data() + pos;
+        *value = (int32_t)((uint32_t)bytes[0] | (uint32_t)bytes[1] << 8 |
+                           (uint32_t)bytes[2] << 16 | (uint32_t)bytes[3] << 24);
+        pos += 4;
+        return true;
+    }
+
+    // Skip separators, refilling as the buffer runs out
+    while (true) {
+        while (pos < end && std::isspace((unsigned char)buffer[pos])) {
+            ++pos;
+        }
+        if (pos < end) break;
+        if (!fill(1)) return false;
+    }
+    // Make sure the whole number is buffered before parsing it
+    size_t tokenEnd = pos;
+    while (true) {
+        while (tokenEnd < end && !std::isspace((unsigned char)buffer[tokenEnd])) {
+            ++tokenEnd;
+        }
+        if (tokenEnd < end || eof) break;
+        size_t offset = tokenEnd - pos;
+        fill(end - pos + 1);
+        tokenEnd = pos + offset;
+    }
+
+    std::string token(buffer.data() + pos, tokenEnd - pos);
+    pos = tokenEnd;
+    char* tokenStop;
+    long parsed = std::strtol(token.c_str(), &tokenStop, 10);
+    if (token.empty() || *tokenStop != '\0') {
+        error = 1;
+        return false;
+    }
+    *value = (int)parsed;
+    return true;
+}
+
+int InputChannel::getError() {
+    return error;
+}
+
+OutputChannel::OutputChannel() {}
+
+OutputChannel::~OutputChannel() {
+    flush();
+    if (fd > STDOUT_FILENO) {
+        close(fd);
+    }
+}
+
+int OutputChannel::open(std::string fileName, bool binary) {
+    this->binary = binary;
+    console = false;
+    if (fileName == "-") {
+        fd = STDOUT_FILENO;
+    } else {
+        fd = ::open(fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            error = 1;
+            return error;
+        }
+    }
+    buffer.resize(BLOCK_SIZE);
+    return 0;
+}
+
+void OutputChannel::setCallback(std::function<void(int)> callback) {
+    this->callback = callback;
+    console = false;
+}
+
+void OutputChannel::put(int value) {
+    recent[count++ % RECENT_SIZE] = value;
+    if (console) {
+        std::cout << value << '\n';
+        return;
+    }
+    if (callback) {
+        callback(value);
+        return;
+    }
+
+    // Longest decimal int plus newline and terminator fits in 16 bytes
+    if (buffer.size() - used < 16) {
+        flush();
+    }
+    if (binary) {
+        uint32_t word = (uint32_t)value;
+        for (int i = 0; i < 4; ++i) {
+            buffer[used++] = (char)(word >> (8 * i));
+        }
+    } else {
+        used += std::snprintf(buffer.data() + used, 16, "%d\n", value);
+    }
+}
+
+std::vector<int> OutputChannel::getRecent() {
+    std::vector<int> values;
+    for (unsigned long i = count > RECENT_SIZE ? count - RECENT_SIZE : 0; i < count; ++i) {
+        values.push_back(recent[i % RECENT_SIZE]);
+    }
+    return values;
+}
+
+int OutputChannel::flush() {
+    if (console) {
+        std::cout.flush();
+        return error;
+    }
+    size_t written = 0;
+    while (written < used) {
+        ssize_t n = write(fd, buffer.data() + written, used - written);
+        if (n < 0) {
+            error = 1;
+            break;
+        }
+        written += n;
+    }
+    used = 0;
+    return error;
+}
+
+int OutputChannel::getError() {
+    return error;
+}
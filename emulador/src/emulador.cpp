@@ -0,0 +1,249 @@
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+
+#include <emulator.hpp>
+#include <lockstep.hpp>
+
+// Trace dumped by the signal handler, which may only use async-signal-safe calls
+static const Trace* signalTrace = nullptr;
+static char signalTraceName[4096];
+
+static void dumpTrace(int sig) {
+    int fd = open(signalTraceName, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd >= 0) {
+        signalTrace->dump(fd);
+        close(fd);
+    }
+    // SIGUSR1 only takes a snapshot; the others still end the run
+    if (sig != SIGUSR1) {
+        signal(sig, SIG_DFL);
+        raise(sig);
+    }
+}
+
+// Runs ended by a limit exit with their own status; any other simulation error exits with 255
+static const int LIMIT_STATUS[] = {0, 2, 3, 4};
+
+// Runs one instance per line of the batch file (its INPUT values) and writes one line per
+// instance, as the servidor answers: OK <instructions> <n> <outputs...> or
+// ERROR <status> <instructions> <message>
+static int runBatch(std::shared_ptr<Image> image, std::string batchName, std::string outputName,
+                    unsigned int lanes, unsigned long maxInstructions, bool laneStats) {
+    std::ifstream batchFile;
+    if (batchName != "-") {
+        batchFile.open(batchName);
+        if (!batchFile.is_open()) {
+            std::cout << "could not open batch file " << batchName << std::endl;
+            return -1;
+        }
+    }
+    std::istream& batch = batchName == "-" ? std::cin : batchFile;
+    std::vector<std::vector<int>> inputs;
+    std::string line;
+    while (std::getline(batch, line)) {
+        std::istringstream values(line);
+        std::vector<int> instance;
+        int value;
+        while (values >> value) {
+            instance.push_back(value);
+        }
+        if (!values.eof()) {
+            std::cout << "invalid value in line " << inputs.size() + 1 << " of " << batchName << std::endl;
+            return -1;
+        }
+        inputs.push_back(instance);
+    }
+
+    Lockstep lockstep(image, lanes);
+    if (maxInstructions > 0) {
+        lockstep.setInstructionLimit(maxInstructions);
+    }
+    auto results = lockstep.run(inputs);
+
+    std::ofstream outFile;
+    if (!outputName.empty() && outputName != "-") {
+        outFile.open(outputName);
+    }
+    std::ostream& out = outFile.is_open() ? outFile : std::cout;
+    for (auto& result : results) {
+        if (result.error) {
+            out << "ERROR " << (result.limit != Emulator::LIMIT_NONE ? LIMIT_STATUS[result.limit] : 255) << " "
+                << result.instructions << " " << result.errMsg << "\n";
+            continue;
+        }
+        out << "OK " << result.instructions << " " << result.outputs.size();
+        for (int value : result.outputs) {
+            out << " " << value;
+        }
+        out << "\n";
+    }
+    out.flush();
+    if (out.fail()) {
+        std::cout << "could not write output" << std::endl;
+        return -1;
+    }
+
+    if (laneStats) {
+        if (lockstep.getLanes() == 1 || !image->isVerified()) {
+            std::cout << "instances ran one at a time" << (image->isVerified() ? "" : ": " + image->getUnverifiedReason()) << std::endl;
+        } else {
+            unsigned long steps = lockstep.getSteps();
+            std::cout << lockstep.getLanes() << " lanes: " << steps << " steps, " << lockstep.getLaneInstructions()
+                      << " instructions, " << std::fixed << std::setprecision(2)
+                      << (steps > 0 ? (double)lockstep.getLaneInstructions() / steps : 0.0) << " lanes per step" << std::endl;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cout << "Missing arguments! Expecting 1:" << std::endl
+        << "Usage: emulador [--no-fusion] [--fusion-stats] [--no-verify] [--trace <trace-file>] [--trace-size <records>] [--max-instructions <n>] [--timeout <seconds>] [-i <input-file>] [-o <output-file>] [--binary-io] [--batch <inputs-file> [--lanes <1|8|16>] [--lane-stats]] <executable-file>" << std::endl;
+        return -1;
+    }
+
+    std::string fileName;
+    bool fusion = true;
+    bool fusionStats = false;
+    bool verify = true;
+    std::string inputName;
+    std::string outputName;
+    bool binaryIO = false;
+    std::string traceName;
+    unsigned int traceSize = 1 << 16;
+    unsigned long maxInstructions = 0;
+    double timeout = 0;
+    std::string batchName;
+    unsigned int lanes = 8;
+    bool laneStats = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = std::string(argv[i]);
+        if (arg == "-i" && i + 1 < argc) {
+            inputName = argv[++i];
+        } else if (arg == "-o" && i + 1 < argc) {
+            outputName = argv[++i];
+        } else if (arg == "--binary-io") {
+            binaryIO = true;
+        } else if (arg == "--no-fusion") {
+            fusion = false;
+        } else if (arg == "--fusion-stats") {
+            fusionStats = true;
+        } else if (arg == "--no-verify") {
+            verify = false;
+        } else if (arg == "--trace" && i + 1 < argc) {
+            traceName = argv[++i];
+        } else if (arg == "--trace-size" && i + 1 < argc) {
+            traceSize = atoi(argv[++i]);
+        } else if (arg == "--max-instructions" && i + 1 < argc) {
+            maxInstructions = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--timeout" && i + 1 < argc) {
+            timeout = std::strtod(argv[++i], nullptr);
+        } else if (arg == "--batch" && i + 1 < argc) {
+            batchName = argv[++i];
+        } else if (arg == "--lanes" && i + 1 < argc) {
+            lanes = atoi(argv[++i]);
+        } else if (arg == "--lane-stats") {
+            laneStats = true;
+        } else {
+            fileName = arg;
+        }
+    }
+    // Executables may be given with or without their extension
+    if (!isSuffix(fileName, ".e")) {
+        fileName += ".e";
+    }
+
+    auto image = std::make_shared<Image>(fileName);
+    if (image->getError()) {
+        std::cout << image->getErrorMessage() << std::endl;
+        return -1;
+    }
+    // Batches run plain instructions, so their instruction counts never depend on fusion
+    if (!batchName.empty()) {
+        if (lanes != 1 && lanes != 8 && lanes != 16) {
+            std::cout << "--lanes must be 1, 8 or 16" << std::endl;
+            return -1;
+        }
+        if (timeout > 0 || !traceName.empty() || !inputName.empty() || binaryIO) {
+            std::cout << "--timeout, --trace, -i and --binary-io do not apply to batches" << std::endl;
+            return -1;
+        }
+        if (verify) {
+            image->verify();
+        }
+        return runBatch(image, batchName, outputName, lanes, maxInstructions, laneStats);
+    }
+    if (fusion) {
+        image->fuse();
+    }
+    if (fusionStats) {
+        image->printFusion();
+    }
+    // Images that fail verification still run, through the checked loop
+    if (verify) {
+        image->verify();
+    }
+
+    Emulator emulator(image);
+    // Console stays the default unless a file (or - for stdin/stdout) is given
+    if (!inputName.empty() || binaryIO) {
+        emulator.setInput(inputName.empty() ? "-" : inputName, binaryIO);
+    }
+    if (!outputName.empty() || binaryIO) {
+        emulator.setOutput(outputName.empty() ? "-" : outputName, binaryIO);
+    }
+
+    if (!traceName.empty()) {
+        if (traceName.size() >= sizeof(signalTraceName)) {
+            std::cout << "trace file name too long" << std::endl;
+            return -1;
+        }
+        emulator.setTrace(traceName, traceSize);
+        signalTrace = emulator.getTrace();
+        std::strcpy(signalTraceName, traceName.c_str());
+        for (int sig : {SIGINT, SIGTERM, SIGHUP, SIGUSR1}) {
+            signal(sig, dumpTrace);
+        }
+    }
+
+    if (maxInstructions > 0) {
+        emulator.setInstructionLimit(maxInstructions);
+    }
+    if (timeout > 0) {
+        emulator.setTimeLimit(timeout);
+    }
+
+    int err = emulator.getError();
+    if (err) {
+        std::cout << emulator.getErrorMessage() << std::endl;
+        return -1;
+    }
+
+    err = emulator.run();
+    if (err && emulator.getLimit() != Emulator::LIMIT_NONE) {
+        std::cout << "simulation stopped: " + emulator.getErrorMessage() << std::endl
+                  << "instructions executed: " << emulator.getInstructionCount() << std::endl
+                  << "last outputs:";
+        for (int value : emulator.getLastOutputs()) {
+            std::cout << " " << value;
+        }
+        std::cout << std::endl;
+        return LIMIT_STATUS[emulator.getLimit()];
+    }
+    if (err) {
+        std::cout << "simulation error: " + emulator.getErrorMessage() << std::endl;
+        return -1;
+    }
+
+    return 0;
+}
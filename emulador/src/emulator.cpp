@@ -0,0 +1,564 @@
+#include <emulator.hpp>
+
+#include <chrono>
+#include <climits>
+#include <sstream>
+#include <sys/mman.h>
+
+// Instructions run between two checks of the time limit
+static const unsigned long TIME_SLICE = 1ul << 20;
+
+Emulator::Emulator(std::shared_ptr<const Image> image) {
+    this->image = image;
+    memorySize = image->getSize();
+    memory = image->mapPrivate(&mapping, &mappingSize);
+    if (!memory) {
+        storage.assign(image->getWords(), image->getWords() + memorySize);
+        memory = storage.data();
+    }
+    pc = image->getEntry();
+    auto& starts = image->getFusionStarts();
+    fusionStart = starts.empty() ? nullptr : starts.data();
+}
+
+Emulator::~Emulator() {
+    if (mapping) {
+        munmap(mapping, mappingSize);
+    }
+}
+
+int Emulator::decode(unsigned int addr) {
+    // Groups that no longer decode cleanly fall back to a plain instruction
+    // (the group was found at load time, but the code may have been rewritten since)
+    Decoded entry;
+    if (fusionStart && fusionStart[addr] != UNDECODED && decodeEntry(memory, memorySize, addr, fusionStart[addr], &entry)) {
+        decoded[addr] = entry;
+        for (unsigned int word = addr; word < addr + entry.length; ++word) {
+            isCode[word] = true;
+        }
+        return 0;
+    }
+
+    int opcode = memory[addr];
+    int length = instructionLength(opcode);
+    if (length == 0) {
+        errMsg = genErrMsg(addr, "invalid opcode " + std::to_string(opcode));
+        return error;
+    }
+    if (addr + length > memorySize) {
+        errMsg = genErrMsg(addr, "instruction crosses end of memory");
+        return error;
+    }
+
+    // Operand addresses are checked once here instead of on every execution
+    entry = {(unsigned char)opcode, (unsigned char)length, {0, 0, 0}};
+    for (int i = 1; i < length; ++i) {
+        unsigned int operand = memory[addr + i];
+        if (operand >= memorySize) {
+            // Writes outside the image end the run like the other limits do
+            if (isa::operandKind(opcode, i - 1) == isa::WRITE) {
+                limitReached = LIMIT_WRITE;
+                errMsg = genErrMsg(addr, "write outside the image: " + std::to_string(memory[addr + i]));
+                return error;
+            }
+            errMsg = genErrMsg(addr, "memory access out of bounds: " + std::to_string(memory[addr + i]));
+            return error;
+        }
+        entry.op[i - 1] = operand;
+    }
+
+    decoded[addr] = entry;
+    for (int i = 0; i < length; ++i) {
+        isCode[addr + i] = true;
+    }
+    // Breakpoints (and the stop after a watched write) are patched over the decoded entry
+    if (debugging && addr != stepOverAddr && (isBreakpoint[addr] || addr == trapAddr)) {
+        decoded[addr].handler = BREAKPOINT;
+    }
+    return 0;
+}
+
+void Emulator::invalidate(unsigned int addr) {
+    // Writes to a watched word stop before the next instruction (pc is already past the store)
+    if (debugging && isWatched[addr]) {
+        stopReason = STOP_WATCHPOINT;
+        watchAddr = addr;
+        trapAddr = pc;
+        if (pc < memorySize) {
+            decoded[pc].handler = UNDECODED;
+        }
+    }
+
+    // Drop every entry whose words include addr; it is decoded again when next reached
+    unsigned int first = addr >= MAX_SPAN - 1 ? addr - (MAX_SPAN - 1) : 0;
+    for (unsigned int start = first; start <= addr; ++start) {
+        if (decoded[start].handler != UNDECODED && start + decoded[start].length > addr) {
+            decoded[start].handler = UNDECODED;
+        }
+    }
+}
+
+template <bool checked, bool traced>
+inline void Emulator::store(unsigned int addr, int value) {
+    memory[addr] = value;
+    if (traced) {
+        traceRecord->event = TRACE_WRITE;
+        traceRecord->addr = addr;
+        traceRecord->value = value;
+    }
+    // Verified images never write into their code
+    if (checked && isCode[addr]) {
+        invalidate(addr);
+    }
+}
+
+int Emulator::run() {
+    if (instructionLimit == ULONG_MAX && timeLimit <= 0) {
+        return resume(ULONG_MAX);
+    }
+    // Limits cost one check per slice
+    while (isRunning()) {
+        runSlice(timeLimit > 0 ? TIME_SLICE : ULONG_MAX);
+    }
+    return error;
+}
+
+int Emulator::runSlice(unsigned long budget) {
+    if (error || !running) {
+        return error;
+    }
+    // The clock starts with the first slice
+    auto now = std::chrono::steady_clock::now();
+    if (!started) {
+        started = true;
+        deadline = now + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(timeLimit));
+    }
+    if (instructionCount >= instructionLimit) {
+        return stopAtLimit(LIMIT_INSTRUCTIONS, "instruction limit of " + std::to_string(instructionLimit) + " reached");
+    }
+    if (timeLimit > 0 && now >= deadline) {
+        std::ostringstream seconds;
+        seconds << timeLimit;
+        return stopAtLimit(LIMIT_TIME, "time limit of " + seconds.str() + " s reached");
+    }
+    unsigned long left = instructionLimit - instructionCount;
+    return resume(budget < left ? budget : left);
+}
+
+int Emulator::stopAtLimit(int reached, std::string message) {
+    limitReached = reached;
+    errMsg = genErrMsg(pc, message);
+    // What the program did so far is kept, as on STOP
+    output.flush();
+    if (trace) {
+        trace->dump(traceName);
+    }
+    return error;
+}
+
+void Emulator::setInstructionLimit(unsigned long count) {
+    instructionLimit = count;
+}
+
+void Emulator::setTimeLimit(double seconds) {
+    timeLimit = seconds;
+}
+
+int Emulator::getLimit() {
+    return limitReached;
+}
+
+std::vector<int> Emulator::getLastOutputs() {
+    return output.getRecent();
+}
+
+int Emulator::resume(unsigned long budget) {
+    if (error || !running) {
+        return error;
+    }
+
+    // Run until STOP, an error or about budget instructions (a group may go slightly past it)
+    unsigned long limit = budget > ULONG_MAX - instructionCount ? ULONG_MAX : instructionCount + budget;
+    int err = 0;
+    if (debugging) {
+        stopReason = STOP_NONE;
+        // Continuing from a breakpoint first runs the instruction under it
+        if (pc == pausedAt && pc < memorySize && isBreakpoint[pc]) {
+            stepOverAddr = pc;
+            decoded[pc].handler = UNDECODED;
+            err = dispatch(instructionCount + 1);
+            decoded[stepOverAddr].handler = UNDECODED;
+            stepOverAddr = NO_ADDRESS;
+        }
+    }
+    if (!err) {
+        err = dispatch(limit);
+    }
+    pausedAt = pc;
+    if (err) {
+        if (trace) {
+            *trace->next() = {pc, UNDECODED, TRACE_ERROR, 0, 0, 0, 0};
+            trace->commit();
+            trace->dump(traceName);
+        }
+        return error;
+    }
+    if (!running && trace && trace->dump(traceName)) {
+        errMsg = "could not write trace " + traceName;
+        error = 1;
+        return error;
+    }
+    if (!running && output.flush()) {
+        errMsg = "could not write output";
+        error = 1;
+        return error;
+    }
+    return 0;
+}
+
+int Emulator::dispatch(unsigned long limit) {
+    // The debugger patches the emulator's own entries, so it always runs the checked loop
+    bool checked = debugging || !image->isVerified();
+    if (trace) {
+        return checked ? execute<true, true>(limit) : execute<false, true>(limit);
+    }
+    return checked ? execute<true, false>(limit) : execute<false, false>(limit);
+}
+
+// Checked loop decodes lazily and guards the program counter and writes into code;
+// verified images run on the entries decoded at load time with none of those checks.
+// Traced loops also record every instruction; untraced ones compile without it
+template <bool checked, bool traced>
+int Emulator::execute(unsigned long limit) {
+    if (checked && !decoded) {
+        decoded = allocateDecoded(memorySize);
+        isCode.assign(memorySize, false);
+    }
+    const Decoded* code = checked ? decoded.get() : image->getDecoded();
+    int value;
+    while (running && instructionCount < limit) {
+        if (checked && pc >= memorySize) {
+            errMsg = genErrMsg(pc, "program counter out of bounds");
+            return error;
+        }
+        unsigned int start = pc;
+        const Decoded& entry = code[pc];
+        int accBefore = acc;
+        unsigned long countBefore = instructionCount;
+        if (traced) {
+            traceRecord = trace->next();
+            *traceRecord = {pc, entry.handler, TRACE_NONE, 0, 0, 0, 0};
+        }
+        switch (entry.handler) {
+        case UNDECODED:
+            // Verification decodes every reachable instruction, so this is the checked loop
+            if (!checked) {
+                errMsg = genErrMsg(pc, "instruction was not verified");
+                return error;
+            }
+            if (decode(pc)) return error;
+            continue;
+        case ADD:
+            acc = isa::add(acc, memory[entry.op[0]]);
+            pc += 2;
+            break;
+        case SUB:
+            acc = isa::subtract(acc, memory[entry.op[0]]);
+            pc += 2;
+            break;
+        case MULT:
+            acc = isa::multiply(acc, memory[entry.op[0]]);
+            pc += 2;
+            break;
+        case DIV:
+            if (memory[entry.op[0]] == 0) {
+                errMsg = genErrMsg(pc, "division by zero");
+                return error;
+            }
+            acc = isa::divide(acc, memory[entry.op[0]]);
+            pc += 2;
+            break;
+        case JMP:
+            pc = entry.op[0];
+            break;
+        case JMPN:
+            pc = acc < 0 ? entry.op[0] : pc + 2;
+            break;
+        case JMPP:
+            pc = acc > 0 ? entry.op[0] : pc + 2;
+            break;
+        case JMPZ:
+            pc = acc == 0 ? entry.op[0] : pc + 2;
+            break;
+        case COPY:
+            pc += 3;
+            store<checked, traced>(entry.op[1], memory[entry.op[0]]);
+            break;
+        case LOAD:
+            acc = memory[entry.op[0]];
+            pc += 2;
+            break;
+        case STORE:
+            pc += 2;
+            store<checked, traced>(entry.op[0], acc);
+            break;
+        case INPUT:
+            if (!input.next(&value)) {
+                errMsg = genErrMsg(pc, "invalid input");
+                return error;
+            }
+            pc += 2;
+            store<checked, traced>(entry.op[0], value);
+            if (traced) {
+                traceRecord->event = TRACE_INPUT;
+            }
+            break;
+        case OUTPUT:
+            output.put(memory[entry.op[0]]);
+            if (traced) {
+                *traceRecord = {start, OUTPUT, TRACE_OUTPUT, 0, 0, entry.op[0], memory[entry.op[0]]};
+            }
+            pc += 2;
+            break;
+        case STOP:
+            running = false;
+            break;
+        case LOAD_ADD_STORE:
+            acc = isa::add(memory[entry.op[0]], memory[entry.op[1]]);
+            pc += 6;
+            instructionCount += 2;
+            store<checked, traced>(entry.op[2], acc);
+            break;
+        case LOAD_SUB_STORE:
+            acc = isa::subtract(memory[entry.op[0]], memory[entry.op[1]]);
+            pc += 6;
+            instructionCount += 2;
+            store<checked, traced>(entry.op[2], acc);
+            break;
+        case LOAD_MULT_STORE:
+            acc = isa::multiply(memory[entry.op[0]], memory[entry.op[1]]);
+            pc += 6;
+            instructionCount += 2;
+            store<checked, traced>(entry.op[2], acc);
+            break;
+        case LOAD_ADD:
+            acc = isa::add(memory[entry.op[0]], memory[entry.op[1]]);
+            pc += 4;
+            ++instructionCount;
+            break;
+        case LOAD_SUB:
+            acc = isa::subtract(memory[entry.op[0]], memory[entry.op[1]]);
+            pc += 4;
+            ++instructionCount;
+            break;
+        case LOAD_MULT:
+            acc = isa::multiply(memory[entry.op[0]], memory[entry.op[1]]);
+            pc += 4;
+            ++instructionCount;
+            break;
+        case ADD_STORE:
+            acc = isa::add(acc, memory[entry.op[0]]);
+            pc += 4;
+            ++instructionCount;
+            store<checked, traced>(entry.op[1], acc);
+            break;
+        case SUB_STORE:
+            acc = isa::subtract(acc, memory[entry.op[0]]);
+            pc += 4;
+            ++instructionCount;
+            store<checked, traced>(entry.op[1], acc);
+            break;
+        case MULT_STORE:
+            acc = isa::multiply(acc, memory[entry.op[0]]);
+            pc += 4;
+            ++instructionCount;
+            store<checked, traced>(entry.op[1], acc);
+            break;
+        case SUB_JMPZ:
+            acc = isa::subtract(acc, memory[entry.op[0]]);
+            pc = acc == 0 ? entry.op[1] : pc + 4;
+            ++instructionCount;
+            break;
+        case SUB_JMPP:
+            acc = isa::subtract(acc, memory[entry.op[0]]);
+            pc = acc > 0 ? entry.op[1] : pc + 4;
+            ++instructionCount;
+            break;
+        case SUB_JMPN:
+            acc = isa::subtract(acc, memory[entry.op[0]]);
+            pc = acc < 0 ? entry.op[1] : pc + 4;
+            ++instructionCount;
+            break;
+        case LOAD_JMPZ:
+            acc = memory[entry.op[0]];
+            pc = acc == 0 ? entry.op[1] : pc + 4;
+            ++instructionCount;
+            break;
+        case LOAD_JMPP:
+            acc = memory[entry.op[0]];
+            pc = acc > 0 ? entry.op[1] : pc + 4;
+            ++instructionCount;
+            break;
+        case LOAD_JMPN:
+            acc = memory[entry.op[0]];
+            pc = acc < 0 ? entry.op[1] : pc + 4;
+            ++instructionCount;
+            break;
+        case COPY_JMP:
+            pc = entry.op[2];
+            store<checked, traced>(entry.op[1], memory[entry.op[0]]);
+            // The copy may have rewritten the jump itself
+            if (checked && decoded[start].handler == UNDECODED) {
+                pc = start + 3;
+                break;
+            }
+            ++instructionCount;
+            break;
+        case STORE_LOAD:
+            pc += 4;
+            store<checked, traced>(entry.op[0], acc);
+            // The store may have rewritten the load
+            if (checked && decoded[start].handler == UNDECODED) {
+                pc = start + 2;
+                break;
+            }
+            acc = memory[entry.op[1]];
+            ++instructionCount;
+            break;
+        case BREAKPOINT:
+            // Stops before running the instruction; the stop after a watched write is removed once hit
+            if (pc == trapAddr) {
+                trapAddr = NO_ADDRESS;
+                decoded[pc].handler = UNDECODED;
+            } else {
+                stopReason = STOP_BREAKPOINT;
+            }
+            return 0;
+        }
+        ++instructionCount;
+        if (traced) {
+            traceRecord->accDelta = (int32_t)((uint32_t)acc - (uint32_t)accBefore);
+            traceRecord->instructions = (uint16_t)(instructionCount - countBefore);
+            trace->commit();
+        }
+    }
+    return 0;
+}
+
+int Emulator::setInput(std::string fileName, bool binary) {
+    if (input.open(fileName, binary)) {
+        errMsg = "could not open input file " + fileName;
+        error = 1;
+    }
+    return error;
+}
+
+int Emulator::setOutput(std::string fileName, bool binary) {
+    if (output.open(fileName, binary)) {
+        errMsg = "could not open output file " + fileName;
+        error = 1;
+    }
+    return error;
+}
+
+void Emulator::setInputCallback(std::function<bool(int*)> callback) {
+    input.setCallback(callback);
+}
+
+void Emulator::setOutputCallback(std::function<void(int)> callback) {
+    output.setCallback(callback);
+}
+
+void Emulator::setTrace(std::string fileName, uint32_t capacity) {
+    trace.reset(new Trace(capacity));
+    traceName = fileName;
+}
+
+const Trace* Emulator::getTrace() {
+    return trace.get();
+}
+
+void Emulator::attach() {
+    if (debugging) {
+        return;
+    }
+    // Fused groups could hide a breakpoint inside them, so the debugger runs plain instructions
+    debugging = true;
+    fusionStart = nullptr;
+    decoded = allocateDecoded(memorySize);
+    isCode.assign(memorySize, false);
+    isBreakpoint.assign(memorySize, false);
+    isWatched.assign(memorySize, false);
+}
+
+int Emulator::setBreakpoint(unsigned int addr, bool enabled) {
+    if (addr >= memorySize) {
+        return 1;
+    }
+    attach();
+    isBreakpoint[addr] = enabled;
+    // Entry is patched (or restored) when decoded again
+    decoded[addr].handler = UNDECODED;
+    return 0;
+}
+
+int Emulator::setWatchpoint(unsigned int addr, bool enabled) {
+    if (addr >= memorySize) {
+        return 1;
+    }
+    attach();
+    isWatched[addr] = enabled;
+    if (enabled) {
+        isCode[addr] = true;
+    }
+    return 0;
+}
+
+int Emulator::getStopReason() {
+    return stopReason;
+}
+
+unsigned int Emulator::getWatchAddress() {
+    return watchAddr;
+}
+
+int Emulator::getAccumulator() {
+    return acc;
+}
+
+unsigned int Emulator::getPc() {
+    return pc;
+}
+
+unsigned int Emulator::getMemorySize() {
+    return memorySize;
+}
+
+int Emulator::readWord(unsigned int addr, int* value) {
+    if (addr >= memorySize) {
+        return 1;
+    }
+    *value = memory[addr];
+    return 0;
+}
+
+bool Emulator::isRunning() {
+    return running && !error;
+}
+
+unsigned long Emulator::getInstructionCount() {
+    return instructionCount;
+}
+
+int Emulator::getError() {
+    return error;
+}
+
+std::string Emulator::getErrorMessage() {
+    return errMsg;
+}
+
+std::string Emulator::genErrMsg(unsigned int addr, std::string message) {
+    error = 1;
+    return "address " + std::to_string(addr) + ": " + message;
+}
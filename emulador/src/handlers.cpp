@@ -0,0 +1,69 @@
+#include <handlers.hpp>
+
+#include <cstdlib>
+
+// Listed in handler order; triples are tried before pairs
+const Handlers::FusionPattern Handlers::fusionPatterns[] = {
+    {LOAD_ADD_STORE, 3, {LOAD, ADD, STORE}, "LOAD ADD STORE"},
+    {LOAD_SUB_STORE, 3, {LOAD, SUB, STORE}, "LOAD SUB STORE"},
+    {LOAD_MULT_STORE, 3, {LOAD, MULT, STORE}, "LOAD MULT STORE"},
+    {LOAD_ADD, 2, {LOAD, ADD}, "LOAD ADD"},
+    {LOAD_SUB, 2, {LOAD, SUB}, "LOAD SUB"},
+    {LOAD_MULT, 2, {LOAD, MULT}, "LOAD MULT"},
+    {ADD_STORE, 2, {ADD, STORE}, "ADD STORE"},
+    {SUB_STORE, 2, {SUB, STORE}, "SUB STORE"},
+    {MULT_STORE, 2, {MULT, STORE}, "MULT STORE"},
+    {SUB_JMPZ, 2, {SUB, JMPZ}, "SUB JMPZ"},
+    {SUB_JMPP, 2, {SUB, JMPP}, "SUB JMPP"},
+    {SUB_JMPN, 2, {SUB, JMPN}, "SUB JMPN"},
+    {LOAD_JMPZ, 2, {LOAD, JMPZ}, "LOAD JMPZ"},
+    {LOAD_JMPP, 2, {LOAD, JMPP}, "LOAD JMPP"},
+    {LOAD_JMPN, 2, {LOAD, JMPN}, "LOAD JMPN"},
+    {COPY_JMP, 2, {COPY, JMP}, "COPY JMP"},
+    {STORE_LOAD, 2, {STORE, LOAD}, "STORE LOAD"},
+};
+
+Handlers::DecodedTable Handlers::allocateDecoded(unsigned int size) {
+    return DecodedTable(size ? (Decoded*)std::calloc(size, sizeof(Decoded)) : nullptr, std::free);
+}
+
+int Handlers::instructionLength(int opcode) {
+    return isa::length(opcode);
+}
+
+bool Handlers::decodeEntry(const int* words, unsigned int size, unsigned int addr, int handler, Decoded* entry) {
+    // A plain instruction is decoded as a one-opcode group
+    int single = addr < size ? words[addr] : 0;
+    const int* opcodes = &single;
+    int count = 1;
+    if (handler >= FIRST_FUSED) {
+        opcodes = fusionPatterns[handler - FIRST_FUSED].opcodes;
+        count = fusionPatterns[handler - FIRST_FUSED].size;
+    } else {
+        handler = single;
+    }
+
+    Decoded result = {(unsigned char)handler, 0, {0, 0, 0}};
+    unsigned int next = addr;
+    int nOperands = 0;
+    for (int k = 0; k < count; ++k) {
+        if (next >= size || words[next] != opcodes[k]) {
+            return false;
+        }
+        int length = instructionLength(words[next]);
+        if (length == 0 || next + length > size) {
+            return false;
+        }
+        for (int i = 1; i < length; ++i) {
+            unsigned int operand = words[next + i];
+            if (operand >= size) {
+                return false;
+            }
+            result.op[nOperands++] = operand;
+        }
+        next += length;
+    }
+    result.length = next - addr;
+    *entry = result;
+    return true;
+}
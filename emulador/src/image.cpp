@@ -0,0 +1,310 @@
+#include <image.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+Image::Image(std::string fileName) {
+    this->fileName = fileName;
+    if (!fileExists(fileName)) {
+        errMsg = "File " + fileName + " does not exist";
+        error = 1;
+        return;
+    }
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    // Binary images are used in place, so loading does not depend on their size
+    fd = open(fileName.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd >= 0 && fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && (size_t)st.st_size >= EXE_HEADER_SIZE) {
+        void* addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr != MAP_FAILED) {
+            TextView contents((const char*)addr, st.st_size);
+            ExecutableHeader header;
+            if (isBinaryExecutable(contents)) {
+                mapping = addr;
+                mappingSize = st.st_size;
+                if (parseExecutableHeader(contents, &header, &errMsg)) {
+                    errMsg += " in file " + fileName;
+                    error = 1;
+                    return;
+                }
+                fileSize = st.st_size;
+                headerSize = header.headerSize;
+                wordCount = header.size + header.bss;
+                entry = header.entry;
+                // BSS words follow the stored ones as zero pages
+                if (header.bss > 0) {
+                    munmap(mapping, mappingSize);
+                    mappingSize = headerSize + 4 * (size_t)wordCount;
+                    mapping = mapWithBss(PROT_READ);
+                    if (!mapping) {
+                        errMsg = "File " + fileName + " could not be mapped";
+                        error = 1;
+                        return;
+                    }
+                }
+                words = (const int*)((const char*)mapping + headerSize);
+                return;
+            }
+            munmap(addr, st.st_size);
+        }
+    }
+    if (fd >= 0) {
+        close(fd);
+        fd = -1;
+    }
+#endif
+
+    // Text images and binary ones on big-endian hosts are read into storage
+    unsigned int bss;
+    if (readExecutable(fileName, &storage, &entry, &bss, &errMsg)) {
+        error = 1;
+        return;
+    }
+    storage.resize(storage.size() + bss, 0);
+    words = storage.data();
+    wordCount = storage.size();
+}
+
+Image::Image(std::vector<int> words, unsigned int entry) {
+    storage = words;
+    this->entry = entry;
+    this->words = storage.data();
+    wordCount = storage.size();
+}
+
+Image::~Image() {
+    if (mapping) {
+        munmap(mapping, mappingSize);
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+void* Image::mapWithBss(int prot) const {
+    // Anonymous zero pages for the whole image, with the file mapped over its start.
+    // The part of the last file page past the end of the file also reads as zeros
+    void* base = mmap(nullptr, mappingSize, prot, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        return nullptr;
+    }
+    if (mmap(base, fileSize, prot, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        munmap(base, mappingSize);
+        return nullptr;
+    }
+    return base;
+}
+
+int* Image::mapPrivate(void** base, size_t* length) const {
+    // Each instance gets its own copy-on-write view: only pages it writes are copied
+    if (!mapping) {
+        return nullptr;
+    }
+    void* addr = mapWithBss(PROT_READ | PROT_WRITE);
+    if (!addr) {
+        return nullptr;
+    }
+    *base = addr;
+    *length = mappingSize;
+    return (int*)((char*)addr + headerSize);
+}
+
+std::vector<bool> Image::findInstructionStarts(std::vector<unsigned int>* starts) {
+    // Follow fall-through and jump targets from the entry point, so data words are never decoded
+    std::vector<bool> isStart(wordCount, false);
+    std::vector<unsigned int> pending = {entry};
+    while (!pending.empty()) {
+        unsigned int addr = pending.back();
+        pending.pop_back();
+        while (addr < wordCount && !isStart[addr]) {
+            int opcode = words[addr];
+            int length = instructionLength(opcode);
+            if (length == 0 || addr + length > wordCount) {
+                break;
+            }
+            isStart[addr] = true;
+            starts->push_back(addr);
+            if (isa::isJump(opcode)) {
+                pending.push_back(words[addr + 1]);
+            }
+            if (isa::endsBlock(opcode)) {
+                break;
+            }
+            addr += length;
+        }
+    }
+    // Later passes only visit reachable code, whatever the size of the data
+    std::sort(starts->begin(), starts->end());
+    return isStart;
+}
+
+int Image::fuse() {
+    if (error) {
+        return error;
+    }
+
+    // Groups change the decoded entries, so the image has to be verified again
+    verified = false;
+    code.reset();
+
+    fusionStart.assign(wordCount, UNDECODED);
+    fusedCount.assign(HANDLER_COUNT, 0);
+    std::vector<unsigned int> starts;
+    auto isStart = findInstructionStarts(&starts);
+    size_t s = 0;
+    while (s < starts.size()) {
+        unsigned int addr = starts[s];
+
+        // Find the longest pattern made of consecutive instructions starting here
+        int matched = -1;
+        unsigned int groupLength = instructionLength(words[addr]);
+        for (int i = 0; i < HANDLER_COUNT - FIRST_FUSED && matched < 0; ++i) {
+            unsigned int next = addr;
+            int k = 0;
+            for (; k < fusionPatterns[i].size; ++k) {
+                if (next >= wordCount || !isStart[next] || words[next] != fusionPatterns[i].opcodes[k]) {
+                    break;
+                }
+                next += instructionLength(words[next]);
+            }
+            if (k == fusionPatterns[i].size) {
+                matched = i;
+                groupLength = next - addr;
+            }
+        }
+
+        // Groups are decoded lazily, the first time execution reaches them
+        if (matched >= 0) {
+            fusionStart[addr] = fusionPatterns[matched].id;
+            ++fusedCount[fusionPatterns[matched].id];
+        }
+        while (s < starts.size() && starts[s] < addr + groupLength) {
+            ++s;
+        }
+    }
+
+    return 0;
+}
+
+int Image::printFusion() {
+    if (error) {
+        return error;
+    }
+    for (int i = 0; i < HANDLER_COUNT - FIRST_FUSED && !fusedCount.empty(); ++i) {
+        auto& pattern = fusionPatterns[i];
+        if (fusedCount[pattern.id] > 0) {
+            std::cerr << pattern.name << ": " << fusedCount[pattern.id] << '\n';
+        }
+    }
+    return 0;
+}
+
+int Image::verify() {
+    if (error) {
+        return error;
+    }
+    // Run after fuse(), since the decoded entries include the groups it found
+    verified = false;
+    code.reset();
+
+    std::vector<unsigned int> starts;
+    auto isStart = findInstructionStarts(&starts);
+    if (entry >= wordCount || !isStart[entry]) {
+        unverifiedReason = "address " + std::to_string(entry) + ": entry point is not an instruction";
+        return 0;
+    }
+    for (size_t s = 0; s < starts.size(); ++s) {
+        unsigned int addr = starts[s];
+        int opcode = words[addr];
+        int length = instructionLength(opcode);
+        // Operands already hold the final addresses, LABEL + N offsets included
+        for (int i = 1; i < length; ++i) {
+            if ((unsigned int)words[addr + i] >= wordCount) {
+                unverifiedReason = "address " + std::to_string(addr) + ": operand out of bounds";
+                return 0;
+            }
+        }
+        if (isa::isJump(opcode) && !isStart[words[addr + 1]]) {
+            unverifiedReason = "address " + std::to_string(addr) + ": jump target is not an instruction";
+            return 0;
+        }
+        if (!isa::endsBlock(opcode) && (addr + length >= wordCount || !isStart[addr + length])) {
+            unverifiedReason = "address " + std::to_string(addr) + ": execution falls into data";
+            return 0;
+        }
+        if (s + 1 < starts.size() && addr + length > starts[s + 1]) {
+            unverifiedReason = "address " + std::to_string(addr) + ": overlapping instructions";
+            return 0;
+        }
+    }
+
+    // Writes into code would invalidate the shared decoded entries
+    for (auto addr : starts) {
+        int opcode = words[addr];
+        for (int i = 1; i < instructionLength(opcode); ++i) {
+            if (isa::operandKind(opcode, i - 1) != isa::WRITE) {
+                continue;
+            }
+            // Last instruction starting at or before the written word
+            auto it = std::upper_bound(starts.begin(), starts.end(), (unsigned int)words[addr + i]);
+            if (it != starts.begin() && *std::prev(it) + instructionLength(words[*std::prev(it)]) > (unsigned int)words[addr + i]) {
+                unverifiedReason = "address " + std::to_string(addr) + ": writes into code";
+                return 0;
+            }
+        }
+    }
+
+    // Every instruction start gets a plain entry, since jumps may land inside a group
+    code = allocateDecoded(wordCount);
+    for (auto addr : starts) {
+        decodeEntry(words, wordCount, addr, UNDECODED, &code[addr]);
+    }
+    for (auto addr : starts) {
+        if (!fusionStart.empty() && fusionStart[addr] != UNDECODED) {
+            decodeEntry(words, wordCount, addr, fusionStart[addr], &code[addr]);
+        }
+    }
+    verified = true;
+    return 0;
+}
+
+bool Image::isVerified() const {
+    return verified;
+}
+
+std::string Image::getUnverifiedReason() {
+    return unverifiedReason;
+}
+
+const Handlers::Decoded* Image::getDecoded() const {
+    return code.get();
+}
+
+const int* Image::getWords() const {
+    return words;
+}
+
+unsigned int Image::getSize() const {
+    return wordCount;
+}
+
+unsigned int Image::getEntry() const {
+    return entry;
+}
+
+const std::vector<unsigned char>& Image::getFusionStarts() const {
+    return fusionStart;
+}
+
+int Image::getError() {
+    return error;
+}
+
+std::string Image::getErrorMessage() {
+    return errMsg;
+}
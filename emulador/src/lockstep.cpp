@@ -0,0 +1,266 @@
+#include <lockstep.hpp>
+
+#include <algorithm>
+
+Lockstep::Lockstep(std::shared_ptr<const Image> image, unsigned int lanes) {
+    this->image = image;
+    // Other widths are rounded down to the nearest supported one
+    this->lanes = lanes >= 16 ? 16 : lanes >= 8 ? 8 : 1;
+}
+
+void Lockstep::setInstructionLimit(unsigned long count) {
+    instructionLimit = count;
+}
+
+unsigned long Lockstep::getSteps() {
+    return steps;
+}
+
+unsigned long Lockstep::getLaneInstructions() {
+    return laneInstructions;
+}
+
+unsigned int Lockstep::getLanes() {
+    return lanes;
+}
+
+std::vector<Lockstep::Result> Lockstep::run(const std::vector<std::vector<int>>& inputs) {
+    std::vector<Result> results(inputs.size());
+    // Only verified images keep every lane on the same code with in-bounds operands
+    if (lanes == 1 || !image->isVerified()) {
+        runEach(inputs, &results);
+    } else if (lanes == 16) {
+        execute<16>(inputs, &results);
+    } else {
+        execute<8>(inputs, &results);
+    }
+    return results;
+}
+
+void Lockstep::runEach(const std::vector<std::vector<int>>& inputs, std::vector<Result>* results) {
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        Result& result = (*results)[i];
+        Emulator emulator(image);
+        size_t next = 0;
+        const std::vector<int>& values = inputs[i];
+        emulator.setInputCallback([&values, next](int* value) mutable {
+            if (next >= values.size()) return false;
+            *value = values[next++];
+            return true;
+        });
+        emulator.setOutputCallback([&result](int value) {
+            result.outputs.push_back(value);
+        });
+        emulator.setInstructionLimit(instructionLimit);
+        result.error = emulator.run();
+        result.instructions = emulator.getInstructionCount();
+        result.limit = emulator.getLimit();
+        result.errMsg = emulator.getErrorMessage();
+        ++steps;
+        laneInstructions += result.instructions;
+    }
+}
+
+// Writes the active lanes of values over a word's lanes, as one vector load and store
+template <unsigned int LANES>
+static inline void storeLanes(int* word, const int* values, const int* active) {
+    int lanes[LANES];
+    std::copy(word, word + LANES, lanes);
+    for (unsigned int lane = 0; lane < LANES; ++lane) {
+        lanes[lane] = active[lane] ? values[lane] : lanes[lane];
+    }
+    std::copy(lanes, lanes + LANES, word);
+}
+
+// Lane loops are plain selects over fixed-size arrays, with operands copied to locals
+// for every lane, active or not, so the compiler turns them into vector instructions;
+// INPUT, OUTPUT and DIV go lane by lane. Arithmetic uses the isa:: helpers, as the
+// interpreter does
+template <unsigned int LANES>
+void Lockstep::execute(const std::vector<std::vector<int>>& inputs, std::vector<Result>* results) {
+    const int* words = image->getWords();
+    unsigned int size = image->getSize();
+    if (!code) {
+        code = allocateDecoded(size);
+    }
+    std::vector<int> memory((size_t)size * LANES);
+    int acc[LANES];
+    unsigned int pc[LANES];
+    // Masks are ints like the lanes they select, so selects stay one vector wide
+    int active[LANES];
+    unsigned long count[LANES];
+    size_t instance[LANES];
+    size_t inputPos[LANES];
+    size_t nextInstance = 0;
+
+    // Lanes without an instance sit at UINT_MAX, past every real pc
+    auto startLane = [&](unsigned int lane) {
+        pc[lane] = UINT_MAX;
+        count[lane] = 0;
+        if (nextInstance >= inputs.size()) return;
+        instance[lane] = nextInstance++;
+        acc[lane] = 0;
+        pc[lane] = image->getEntry();
+        inputPos[lane] = 0;
+        for (unsigned int addr = 0; addr < size; ++addr) {
+            memory[(size_t)addr * LANES + lane] = words[addr];
+        }
+    };
+    // Errors are reported at the lane's pc, which is only advanced after the instruction ran
+    auto endLane = [&](unsigned int lane, int limit, std::string message) {
+        Result& result = (*results)[instance[lane]];
+        result.instructions = count[lane];
+        laneInstructions += count[lane];
+        if (!message.empty()) {
+            result.error = 1;
+            result.limit = limit;
+            result.errMsg = "address " + std::to_string(pc[lane]) + ": " + message;
+        }
+        active[lane] = 0;
+        startLane(lane);
+    };
+
+    for (unsigned int lane = 0; lane < LANES; ++lane) {
+        startLane(lane);
+    }
+    // A lane runs at most one instruction per step, so no lane reaches the limit before
+    // this many more steps; lanes are only checked then
+    unsigned long limitCheck = instructionLimit;
+    while (true) {
+        unsigned int at = UINT_MAX;
+        for (unsigned int lane = 0; lane < LANES; ++lane) {
+            at = pc[lane] < at ? pc[lane] : at;
+        }
+        if (at == UINT_MAX) break;
+        for (unsigned int lane = 0; lane < LANES; ++lane) {
+            active[lane] = pc[lane] == at ? 1 : 0;
+        }
+        // Verification decoded every reachable instruction once already, so this cannot fail
+        if (code[at].handler == UNDECODED && !decodeEntry(words, size, at, words[at], &code[at])) {
+            for (unsigned int lane = 0; lane < LANES; ++lane) {
+                if (active[lane]) endLane(lane, Emulator::LIMIT_NONE, "instruction was not verified");
+            }
+            continue;
+        }
+        ++steps;
+
+        const Decoded& entry = code[at];
+        int* a = &memory[(size_t)entry.op[0] * LANES];
+        int* b = &memory[(size_t)entry.op[1] * LANES];
+        unsigned int fallThrough = at + entry.length;
+        unsigned int target = entry.op[0];
+        // Operands are in bounds in a verified image, jump targets included
+        int value[LANES];
+        std::copy(a, a + LANES, value);
+        unsigned int next[LANES];
+        switch (entry.handler) {
+        case JMP:
+            for (unsigned int lane = 0; lane < LANES; ++lane) {
+                next[lane] = target;
+            }
+            break;
+        case JMPN:
+            for (unsigned int lane = 0; lane < LANES; ++lane) {
+                next[lane] = acc[lane] < 0 ? target : fallThrough;
+            }
+            break;
+        case JMPP:
+            for (unsigned int lane = 0; lane < LANES; ++lane) {
+                next[lane] = acc[lane] > 0 ? target : fallThrough;
+            }
+            break;
+        case JMPZ:
+            for (unsigned int lane = 0; lane < LANES; ++lane) {
+                next[lane] = acc[lane] == 0 ? target : fallThrough;
+            }
+            break;
+        default:
+            for (unsigned int lane = 0; lane < LANES; ++lane) {
+                next[lane] = fallThrough;
+            }
+            break;
+        }
+        switch (entry.handler) {
+        case ADD:
+            for (unsigned int lane = 0; lane < LANES; ++lane) {
+                int sum = isa::add(acc[lane], value[lane]);
+                acc[lane] = active[lane] ? sum : acc[lane];
+            }
+            break;
+        case SUB:
+            for (unsigned int lane = 0; lane < LANES; ++lane) {
+                int sum = isa::subtract(acc[lane], value[lane]);
+                acc[lane] = active[lane] ? sum : acc[lane];
+            }
+            break;
+        case MULT:
+            for (unsigned int lane = 0; lane < LANES; ++lane) {
+                int sum = isa::multiply(acc[lane], value[lane]);
+                acc[lane] = active[lane] ? sum : acc[lane];
+            }
+            break;
+        case DIV:
+            for (unsigned int lane = 0; lane < LANES; ++lane) {
+                if (!active[lane]) continue;
+                if (value[lane] == 0) {
+                    endLane(lane, Emulator::LIMIT_NONE, "division by zero");
+                    continue;
+                }
+                acc[lane] = isa::divide(acc[lane], value[lane]);
+            }
+            break;
+        case COPY:
+            storeLanes<LANES>(b, value, active);
+            break;
+        case LOAD:
+            for (unsigned int lane = 0; lane < LANES; ++lane) {
+                acc[lane] = active[lane] ? value[lane] : acc[lane];
+            }
+            break;
+        case STORE:
+            storeLanes<LANES>(a, acc, active);
+            break;
+        case INPUT:
+            for (unsigned int lane = 0; lane < LANES; ++lane) {
+                if (!active[lane]) continue;
+                const std::vector<int>& values = inputs[instance[lane]];
+                if (inputPos[lane] >= values.size()) {
+                    endLane(lane, Emulator::LIMIT_NONE, "invalid input");
+                    continue;
+                }
+                a[lane] = values[inputPos[lane]++];
+            }
+            break;
+        case OUTPUT:
+            for (unsigned int lane = 0; lane < LANES; ++lane) {
+                if (active[lane]) (*results)[instance[lane]].outputs.push_back(value[lane]);
+            }
+            break;
+        case STOP:
+            for (unsigned int lane = 0; lane < LANES; ++lane) {
+                if (!active[lane]) continue;
+                ++count[lane];
+                endLane(lane, Emulator::LIMIT_NONE, "");
+            }
+            break;
+        }
+
+        for (unsigned int lane = 0; lane < LANES; ++lane) {
+            pc[lane] = active[lane] ? next[lane] : pc[lane];
+            count[lane] += active[lane];
+        }
+        // The interpreter checks the limit before each instruction, so a lane at the
+        // limit that has not stopped ends there
+        if (--limitCheck == 0) {
+            unsigned long most = 0;
+            for (unsigned int lane = 0; lane < LANES; ++lane) {
+                if (pc[lane] != UINT_MAX && count[lane] >= instructionLimit) {
+                    endLane(lane, Emulator::LIMIT_INSTRUCTIONS,
+                            "instruction limit of " + std::to_string(instructionLimit) + " reached");
+                }
+                most = count[lane] > most ? count[lane] : most;
+            }
+            limitCheck = instructionLimit - most;
+        }
+    }
+}
@@ -0,0 +1,103 @@
+#include <scheduler.hpp>
+
+Scheduler::Scheduler(unsigned int nWorkers, unsigned long sliceSize) : nextQueue(0), queued(0) {
+    if (nWorkers == 0) {
+        nWorkers = 1;
+    }
+    this->sliceSize = sliceSize;
+    for (unsigned int i = 0; i < nWorkers; ++i) {
+        queues.push_back(std::unique_ptr<WorkerQueue>(new WorkerQueue()));
+    }
+    for (unsigned int i = 0; i < nWorkers; ++i) {
+        workers.push_back(std::thread(&Scheduler::work, this, i));
+    }
+}
+
+Scheduler::~Scheduler() {
+    wait();
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        stopping = true;
+    }
+    workAvailable.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+void Scheduler::submit(Emulator* emulator, std::function<void(Emulator*)> done) {
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        ++pending;
+    }
+    push(nextQueue++ % queues.size(), {emulator, done});
+}
+
+void Scheduler::wait() {
+    std::unique_lock<std::mutex> lock(stateMutex);
+    allDone.wait(lock, [this]() { return pending == 0; });
+}
+
+void Scheduler::push(unsigned int worker, Job job) {
+    {
+        std::lock_guard<std::mutex> lock(queues[worker]->mutex);
+        queues[worker]->jobs.push_back(job);
+    }
+    // Counted under the state lock so a worker about to sleep cannot miss it
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        ++queued;
+    }
+    workAvailable.notify_one();
+}
+
+bool Scheduler::popLocal(unsigned int worker, Job* job) {
+    std::lock_guard<std::mutex> lock(queues[worker]->mutex);
+    if (queues[worker]->jobs.empty()) {
+        return false;
+    }
+    *job = queues[worker]->jobs.front();
+    queues[worker]->jobs.pop_front();
+    --queued;
+    return true;
+}
+
+bool Scheduler::steal(unsigned int worker, Job* job) {
+    for (unsigned int i = 1; i < queues.size(); ++i) {
+        auto& victim = *queues[(worker + i) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.jobs.empty()) {
+            *job = victim.jobs.back();
+            victim.jobs.pop_back();
+            --queued;
+            return true;
+        }
+    }
+    return false;
+}
+
+void Scheduler::work(unsigned int worker) {
+    while (true) {
+        Job job;
+        if (!popLocal(worker, &job) && !steal(worker, &job)) {
+            std::unique_lock<std::mutex> lock(stateMutex);
+            workAvailable.wait(lock, [this]() { return queued > 0 || stopping; });
+            if (stopping && queued == 0) {
+                return;
+            }
+            continue;
+        }
+
+        job.emulator->runSlice(sliceSize);
+        if (job.emulator->isRunning()) {
+            push(worker, job);
+            continue;
+        }
+
+        job.done(job.emulator);
+        std::lock_guard<std::mutex> lock(stateMutex);
+        if (--pending == 0) {
+            allDone.notify_all();
+        }
+    }
+}
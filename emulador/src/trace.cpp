@@ -0,0 +1,103 @@
+#include <trace.hpp>
+
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <reader.hpp>
+
+Trace::Trace(uint32_t capacity) {
+    uint32_t size = 1;
+    while (size < capacity && size < (1u << 31)) {
+        size <<= 1;
+    }
+    records.resize(size);
+    mask = size - 1;
+}
+
+uint64_t Trace::getCount() const {
+    return count;
+}
+
+static bool writeAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t n = write(fd, data, size);
+        if (n < 0) {
+            return false;
+        }
+        data += n;
+        size -= n;
+    }
+    return true;
+}
+
+int Trace::dump(int fd) const {
+    // Header is packed by hand into a fixed buffer, no allocation
+    uint64_t total = count;
+    uint32_t capacity = mask + 1;
+    char header[TRACE_HEADER_SIZE];
+    std::memcpy(header, TRACE_MAGIC, sizeof(TRACE_MAGIC));
+    std::memcpy(header + 4, &TRACE_VERSION, 2);
+    uint16_t recordSize = sizeof(TraceRecord);
+    std::memcpy(header + 6, &recordSize, 2);
+    std::memcpy(header + 8, &capacity, 4);
+    std::memcpy(header + 12, &total, 8);
+    std::memcpy(header + 20, &instructions, 8);
+    if (!writeAll(fd, header, sizeof(header))) {
+        return 1;
+    }
+
+    // Oldest record is the one the next push would overwrite once the ring is full
+    const char* ring = (const char*)records.data();
+    if (total <= capacity) {
+        return writeAll(fd, ring, total * sizeof(TraceRecord)) ? 0 : 1;
+    }
+    size_t oldest = total & mask;
+    if (!writeAll(fd, ring + oldest * sizeof(TraceRecord), (capacity - oldest) * sizeof(TraceRecord)) ||
+        !writeAll(fd, ring, oldest * sizeof(TraceRecord))) {
+        return 1;
+    }
+    return 0;
+}
+
+int Trace::dump(std::string fileName) const {
+    int fd = open(fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return 1;
+    }
+    int err = dump(fd);
+    close(fd);
+    return err;
+}
+
+int readTrace(std::string fileName, TraceHeader* header, std::vector<TraceRecord>* records, std::string* errMsg) {
+    FileReader file(fileName);
+    if (file.getError()) {
+        *errMsg = "could not read " + fileName;
+        return 1;
+    }
+    TextView contents = file.contents();
+    if (contents.size < TRACE_HEADER_SIZE || std::memcmp(contents.data, TRACE_MAGIC, sizeof(TRACE_MAGIC)) != 0) {
+        *errMsg = fileName + " is not a trace";
+        return 1;
+    }
+    std::memcpy(header->magic, contents.data, 4);
+    std::memcpy(&header->version, contents.data + 4, 2);
+    std::memcpy(&header->recordSize, contents.data + 6, 2);
+    std::memcpy(&header->capacity, contents.data + 8, 4);
+    std::memcpy(&header->count, contents.data + 12, 8);
+    std::memcpy(&header->instructions, contents.data + 20, 8);
+    if (header->version != TRACE_VERSION || header->recordSize != sizeof(TraceRecord)) {
+        *errMsg = fileName + ": unsupported trace version " + std::to_string(header->version);
+        return 1;
+    }
+
+    uint64_t kept = header->count < header->capacity ? header->count : header->capacity;
+    if (contents.size - TRACE_HEADER_SIZE != kept * sizeof(TraceRecord)) {
+        *errMsg = fileName + ": truncated trace";
+        return 1;
+    }
+    records->resize(kept);
+    std::memcpy(records->data(), contents.data + TRACE_HEADER_SIZE, kept * sizeof(TraceRecord));
+    return 0;
+}
@@ -0,0 +1,199 @@
+#include <iostream>
+#include <iterator>
+#include <list>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include <assembler.hpp>
+#include <emulator.hpp>
+#include <linker.hpp>
+#include <preprocessor.hpp>
+
+// Pre-processes and assembles one source, writing the intermediate files only when asked to
+static int assemble(std::string fileName, std::unique_ptr<PreProcessor> pp, bool writePre, bool writeObj, bool singlePass,
+                    unsigned int nThreads, ObjectModule* object) {
+    if (pp->getError()) {
+        return -1;
+    }
+    if (pp->preProcess()) {
+        std::cout << "Something wrong happened during pre-processing\n";
+        return -1;
+    }
+    if (writePre) {
+        pp->writeOutput();
+    }
+    Assembler assembler(fileName, pp->getOutput());
+    assembler.setIncludedFiles(pp->getIncludedFiles());
+    pp.reset();
+
+    int err;
+    if (nThreads > 0) {
+        err = assembler.parallelPass(nThreads);
+        if (err) {
+            std::cout << "parallel pass error: " + assembler.getErrorMessage() << std::endl;
+            return -1;
+        }
+    } else if (singlePass) {
+        err = assembler.singlePass();
+        if (err) {
+            std::cout << "single pass error: " + assembler.getErrorMessage() << std::endl;
+            return -1;
+        }
+    } else {
+        err = assembler.firstPass();
+        if (err) {
+            std::cout << "first pass error: " + assembler.getErrorMessage() << std::endl;
+            return -1;
+        }
+        err = assembler.secondPass();
+        if (err) {
+            std::cout << "second pass error: " + assembler.getErrorMessage() << std::endl;
+            return -1;
+        }
+    }
+
+    if (writeObj && assembler.writeOutput()) {
+        std::cout << "write error: " + assembler.getErrorMessage() << std::endl;
+        return -1;
+    }
+    *object = assembler.getObject();
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cout << "Missing arguments! Expecting at least 1:" << std::endl
+        << "Usage: executor [--pre] [--obj] [--exe] [--binary] [--single-pass | -j <threads>] [--include-cache <dir>] [-i <input-file>] [-o <output-file>] <main-source-or--> ...[module-sources]" << std::endl;
+        return -1;
+    }
+
+    std::list<std::string> sourceNames;
+    bool writePre = false;
+    bool writeObj = false;
+    bool writeExe = false;
+    bool binary = false;
+    bool singlePass = false;
+    unsigned int nThreads = 0;
+    std::string inputName;
+    std::string outputName;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = std::string(argv[i]);
+        if (arg == "--pre") {
+            writePre = true;
+        } else if (arg == "--obj") {
+            writeObj = true;
+        } else if (arg == "--exe") {
+            writeExe = true;
+        } else if (arg == "--binary") {
+            binary = true;
+        } else if (arg == "--single-pass") {
+            singlePass = true;
+        } else if (arg == "--include-cache" && i + 1 < argc) {
+            PreProcessor::setIncludeCache(argv[++i]);
+        } else if (arg == "-j" && i + 1 < argc) {
+            nThreads = atoi(argv[++i]);
+            if (nThreads == 0) {
+                nThreads = std::thread::hardware_concurrency();
+            }
+        } else if (arg == "-i" && i + 1 < argc) {
+            inputName = argv[++i];
+        } else if (arg == "-o" && i + 1 < argc) {
+            outputName = argv[++i];
+        } else {
+            sourceNames.push_back(arg);
+        }
+    }
+    if (sourceNames.empty()) {
+        std::cout << "No source to run" << std::endl;
+        return -1;
+    }
+
+    // Source named - is read from stdin; its intermediate files are named stdin.*
+    bool readsStdin = false;
+    std::list<ObjectModule> objects;
+    for (auto sourceName : sourceNames) {
+        std::unique_ptr<PreProcessor> pp;
+        std::string fileName = sourceName;
+        if (sourceName == "-") {
+            if (readsStdin) {
+                std::cout << "only one source can be read from stdin" << std::endl;
+                return -1;
+            }
+            if (inputName.empty() || inputName == "-") {
+                std::cout << "program input must come from a file (-i) when the source is read from stdin" << std::endl;
+                return -1;
+            }
+            readsStdin = true;
+            std::string source((std::istreambuf_iterator<char>(std::cin)), std::istreambuf_iterator<char>());
+            fileName = "stdin";
+            pp.reset(new PreProcessor(fileName, source));
+        } else {
+            pp.reset(new PreProcessor(sourceName));
+        }
+        ObjectModule object;
+        if (assemble(fileName, std::move(pp), writePre, writeObj, singlePass, nThreads, &object)) {
+            return -1;
+        }
+        objects.push_back(object);
+    }
+
+    // A single program without BEGIN/END is already executable; modules go through the linker
+    std::vector<int> words;
+    unsigned int bss;
+    if (objects.size() == 1 && !objects.front().isModule) {
+        words = objects.front().code;
+        bss = objects.front().bss;
+        if (writeExe && writeExecutable(objects.front().name + ".e", words, binary, 0, bss)) {
+            std::cout << "could not write " << objects.front().name << ".e" << std::endl;
+            return -1;
+        }
+    } else {
+        for (auto& object : objects) {
+            if (!object.isModule) {
+                std::cout << "error in file \"" << object.name << "\": only modules (BEGIN/END) can be linked" << std::endl;
+                return -1;
+            }
+        }
+        Linker linker(objects.front().name, objects);
+        objects.clear();
+        if (linker.parseTables() || linker.link(nThreads > 0 ? nThreads : 1)) {
+            std::cout << linker.getErrorMessage();
+            return -1;
+        }
+        if (writeExe && linker.writeOutput(binary)) {
+            std::cout << linker.getErrorMessage();
+            return -1;
+        }
+        words = linker.getCode();
+        bss = linker.getBss();
+    }
+
+    words.resize(words.size() + bss, 0);
+    auto image = std::make_shared<Image>(words);
+    words = std::vector<int>();
+    image->fuse();
+    image->verify();
+
+    Emulator emulator(image);
+    // Console stays the default, so results are streamed to stdout as they are produced
+    if (!outputName.empty()) {
+        emulator.setOutput(outputName, false);
+    }
+    if (!inputName.empty()) {
+        emulator.setInput(inputName, false);
+    }
+    int err = emulator.getError();
+    if (err) {
+        std::cout << emulator.getErrorMessage() << std::endl;
+        return -1;
+    }
+
+    err = emulator.run();
+    if (err) {
+        std::cout << "simulation error: " + emulator.getErrorMessage() << std::endl;
+        return -1;
+    }
+
+    return 0;
+}
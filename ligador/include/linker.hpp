@@ -1,16 +1,23 @@
+#include <algorithm>
+#include <atomic>
 #include <iostream>
 #include <string>
 #include <list>
 #include <map>
 #include <vector>
 #include <set>
+#include <thread>
 
+#include <executable.hpp>
+#include <isa.hpp>
+#include <map.hpp>
+#include <object.hpp>
 #include <utils.hpp>
 
 class Linker {
     private:
         std::regex intRegEx = std::regex("(\\+|-)?[0-9]+");
-        std::regex hexRegEx = std::regex("0(x|X)[0-9a-f]{1,4}");
+        std::regex hexRegEx = std::regex("0(x|X)[0-9a-fA-F]{1," + std::to_string(WORD_BITS / 4) + "}");
         std::regex natRegEx = std::regex("[0-9]+");
 
         int error = 0;
@@ -24,14 +31,36 @@ class Linker {
         std::map<std::string, std::map<std::string, std::list<unsigned int>>> useTables;
         std::set<std::string> definedSymbols;
         std::map<std::string, std::map<std::string, unsigned int>> defTables;
+        // Public symbols of all modules at their linked addresses
+        std::map<std::string, unsigned int> globalDefTable;
         std::map<std::string, std::list<unsigned int>> relativeListMap;
         std::map<std::string, std::vector<int>> machineCode;
+        // TEXT ranges of each module's code, as recorded in its object
+        std::map<std::string, std::vector<std::pair<unsigned int, unsigned int>>> textRangesMap;
+        bool inText(const std::string&, unsigned int);
         std::map<std::string, unsigned int> sizeMap;
         std::map<std::string, unsigned int> byteOffsetMap;
+        // BSS of every module goes after the code of all modules and is never materialised
+        std::map<std::string, unsigned int> bssSizeMap;
+        std::map<std::string, unsigned int> bssOffsetMap;
+        unsigned int linkedBss = 0;
+        // Word width of each module, which must all agree
+        std::map<std::string, unsigned int> wordBitsMap;
+        unsigned int linkedWordBits = WORD_BITS;
+        unsigned int relocate(const std::string&, unsigned int) const;
 
         std::vector<int> linkedCode;
+        unsigned int mergedConstants = 0;
+        // Words each module lost to mergeConstants()
+        std::map<std::string, unsigned int> droppedMap;
+        // Operands of the instructions in TEXT, at module addresses and with their kind, then
+        // the relocated or external words outside TEXT (addresses kept in DATA) as NO_OPERAND
+        void scanText(std::string, std::vector<std::pair<unsigned int, int>>* operands);
+        // Result of a partial link, still relocatable
+        ObjectModule partialObject;
     public:
         Linker(std::list<std::string>);
+        Linker(std::string, std::list<ObjectModule>);
         int printOutput();
         int getError();
         std::string getErrorMessage();
@@ -39,6 +68,20 @@ class Linker {
         int parseTables();
         int printTables();
 
-        int link();
-        int writeOutput();
+        // Modules are relocated by up to nThreads threads
+        int link(unsigned int nThreads = 1);
+        // Shares read-only DATA words of equal value between all modules
+        int mergeConstants();
+        unsigned int getMergedConstants();
+        // Layout of the linked image, after link() or linkPartial()
+        LinkMap getMap();
+        int writeOutput(bool binary = false);
+        // Combines the modules into one object instead of an executable
+        int linkPartial();
+        int writePartial();
+        void setOutputName(std::string);
+        const std::vector<int>& getCode();
+        unsigned int getBss();
+        unsigned int getWordBits();
+        const std::map<std::string, unsigned int>& getSymbols();
 };
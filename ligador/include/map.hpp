@@ -0,0 +1,41 @@
+#pragma once
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Where a module landed in the linked image
+struct MapModule {
+    std::string name;
+    unsigned int base = 0;
+    unsigned int size = 0;
+    unsigned int code = 0;
+    unsigned int data = 0;
+    unsigned int bssBase = 0;
+    unsigned int bss = 0;
+};
+
+// Public symbol at its linked address, and how many times other modules use it
+struct MapSymbol {
+    std::string label;
+    unsigned int address = 0;
+    std::string section;
+    std::string module;
+    unsigned int uses = 0;
+};
+
+struct LinkMap {
+    unsigned int wordBits = WORD_BITS;
+    std::vector<MapModule> modules;
+    std::vector<MapSymbol> symbols;
+    unsigned int code = 0;
+    unsigned int data = 0;
+    unsigned int bss = 0;
+};
+
+// Text maps are one record per line; names ending in .json get JSON instead
+int writeMap(std::string fileName, const LinkMap& map);
+// Only text maps can be read back
+int readMap(std::string fileName, LinkMap* map, std::string* errMsg);
+// Prints what changed in sizes, modules and symbols from before to after
+void diffMaps(const LinkMap& before, const LinkMap& after, std::ostream& out);
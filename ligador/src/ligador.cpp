@@ -1,21 +1,90 @@
+#include <cstdlib>
 #include <iostream>
 #include <list>
+#include <thread>
 
 #include <linker.hpp>
 
+static int writeLinkMap(Linker& linker, std::string mapName, std::string oldMapName, const LinkMap& oldMap) {
+    if (mapName.empty() && oldMapName.empty()) {
+        return 0;
+    }
+    LinkMap map = linker.getMap();
+    if (!oldMapName.empty()) {
+        diffMaps(oldMap, map, std::cout);
+    }
+    if (!mapName.empty() && writeMap(mapName, map)) {
+        std::cout << "could not write " << mapName << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
 int main(int argc, char** argv) {
     if (argc < 2) {
         std::cout << "Missing arguments! Expecting at least 1:" << std::endl
-        << "Usage: montador <main-file-to-link-without-extension> ...[modules-to-link]" << std::endl;
+        << "Usage: montador [--binary] [--merge-constants] [-r -o <output-object>] [--map <map-file>] [--diff-map <old-map-file>] [-j <threads>] <main-file-to-link-without-extension> ...[modules-to-link]" << std::endl;
         return -1;
     }
 
     std::list<std::string> filesToLink;
+    bool binary = false;
+    bool merge = false;
+    bool partial = false;
+    std::string outputName;
+    std::string mapName;
+    std::string oldMapName;
+    unsigned int nThreads = 1;
     for (int i = 1; i < argc; ++i) {
-        filesToLink.push_back(std::string(argv[i]));
+        std::string arg = std::string(argv[i]);
+        if (arg == "--binary") {
+            binary = true;
+        } else if (arg == "--merge-constants") {
+            merge = true;
+        } else if (arg == "-r") {
+            partial = true;
+        } else if (arg == "-o" && i + 1 < argc) {
+            outputName = argv[++i];
+        } else if (arg == "--map" && i + 1 < argc) {
+            mapName = argv[++i];
+        } else if (arg == "--diff-map" && i + 1 < argc) {
+            oldMapName = argv[++i];
+        } else if (arg == "-j" && i + 1 < argc) {
+            nThreads = atoi(argv[++i]);
+            if (nThreads == 0) {
+                nThreads = std::thread::hardware_concurrency();
+            }
+        } else {
+            filesToLink.push_back(arg);
+        }
+    }
+
+    // Partial links write an .obj, which must not replace one of their inputs
+    if (partial && outputName.empty()) {
+        std::cout << "partial links (-r) need an output name (-o)" << std::endl;
+        return -1;
+    }
+    if (partial && (binary || merge)) {
+        std::cout << "--binary and --merge-constants only apply to executables" << std::endl;
+        return -1;
+    }
+
+    // Old map is read before anything is written, as it may be the one being replaced
+    LinkMap oldMap;
+    if (!oldMapName.empty()) {
+        std::string errMsg;
+        if (readMap(oldMapName, &oldMap, &errMsg)) {
+            std::cout << errMsg << std::endl;
+            return -1;
+        }
     }
+    // The map replaces the raw tables on stdout
+    bool quiet = !mapName.empty() || !oldMapName.empty();
 
     Linker linker(filesToLink);
+    if (!outputName.empty()) {
+        linker.setOutputName(outputName);
+    }
 
     int err;
     err = linker.parseTables();
@@ -24,14 +93,45 @@ int main(int argc, char** argv) {
         return -1;
     }
 
-    err = linker.link();
+    if (partial) {
+        err = linker.linkPartial();
+        if (!err) {
+            if (!quiet) linker.printTables();
+            err = linker.writePartial();
+        }
+        if (err) {
+            std::cout << linker.getErrorMessage();
+            return -1;
+        }
+        return writeLinkMap(linker, mapName, oldMapName, oldMap) ? -1 : 0;
+    }
+
+    err = linker.link(nThreads);
     if (err) {
         std::cout << linker.getErrorMessage();
         return -1;
     }
 
-    linker.printTables();
-    linker.writeOutput();
+    if (merge) {
+        err = linker.mergeConstants();
+        if (err) {
+            std::cout << linker.getErrorMessage();
+            return -1;
+        }
+    }
+
+    if (!quiet) linker.printTables();
+    if (merge) {
+        std::cout << "merged constants: " << linker.getMergedConstants() << std::endl;
+    }
+    err = linker.writeOutput(binary);
+    if (err) {
+        std::cout << linker.getErrorMessage();
+        return -1;
+    }
+    if (writeLinkMap(linker, mapName, oldMapName, oldMap)) {
+        return -1;
+    }
 
     return 0;
 }
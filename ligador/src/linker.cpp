@@ -10,30 +10,65 @@ Linker::Linker(std::list<std::string> filesToLink) {
             error = 1;
             return;
         }
-        // Open file
-        std::ifstream objFile;
-        objFile.open(objName);
-        std::string line;
+        // Map file and split its lines in place
+        FileReader objFile(objName);
+        if (objFile.getError()) {
+            errMsg = "File " + objName + " could not be read\n";
+            error = 1;
+            return;
+        }
+        TextView line;
         std::list<std::vector<std::string>> fileLines;
-        // Handle TABLE USE section
-        while (getline(objFile, line)) {
+        while (objFile.nextLine(&line)) {
             std::vector<std::string> tokens;
             if (line == "TABLE USE" ||
                 line == "TABLE DEFINITION" ||
                 line == "RELATIVE" ||
+                line == "BSS" ||
+                line == "WORD" ||
+                line == "TEXT" ||
                 line == "CODE")
             {
-                tokens.push_back(line);
+                tokens.push_back(line.str());
             } else {
-                tokens = split(line, ' ');
+                for (auto token : splitTokens(line)) {
+                    tokens.push_back(token.str());
+                }
+                // Blank lines carry no entries
+                if (tokens.empty()) continue;
             }
 
             fileLines.push_back(tokens);
         }
         srcFiles[objName] = fileLines;
         srcFileNames.push_back(objName);
+    }
+}
 
-        objFile.close();
+Linker::Linker(std::string outputName, std::list<ObjectModule> objects) {
+    this->outputName = outputName;
+
+    for (auto& object : objects) {
+        std::string objName = object.name + ".obj";
+        for (auto use : object.useTable) {
+            useTables[objName][std::get<0>(use)].push_back(std::get<1>(use));
+        }
+        for (auto def : object.definitionTable) {
+            auto label = std::get<0>(def);
+            // Check for global redefinition
+            if (definedSymbols.count(label) > 0) {
+                errMsg = genErrMsg(objName, "TABLE DEFINITION symbol " + label + "global redefinition");
+                return;
+            }
+            defTables[objName][label] = std::get<1>(def);
+            definedSymbols.insert(label);
+        }
+        relativeListMap[objName] = object.relative;
+        machineCode[objName] = object.code;
+        textRangesMap[objName] = object.text;
+        bssSizeMap[objName] = object.bss;
+        wordBitsMap[objName] = object.wordBits;
+        srcFileNames.push_back(objName);
     }
 }
 
@@ -42,6 +77,9 @@ enum {
     USE,
     DEF,
     REL,
+    BSS,
+    WORD,
+    TEXT,
     CODE
 };
 
@@ -50,13 +88,17 @@ int Linker::parseTables() {
         return error;
     }
 
-    unsigned int byteOffset = 0;
     for (auto fileName : srcFileNames) {
+        // Modules given in memory come with their tables already filled in
+        if (srcFiles.count(fileName) == 0) {
+            continue;
+        }
         std::map<std::string, std::list<unsigned int>> useTable;
         std::map<std::string, unsigned int> defTable;
 
         auto lines = srcFiles[fileName];
         auto section = NONE;
+        bool hasText = false;
         for (auto line : lines) {
             // Handle section change
             if (line[0] == "TABLE USE") {
@@ -68,6 +110,16 @@ int Linker::parseTables() {
             } else if (line[0] == "RELATIVE") {
                 section = REL;
                 continue;
+            } else if (line[0] == "BSS") {
+                section = BSS;
+                continue;
+            } else if (line[0] == "WORD") {
+                section = WORD;
+                continue;
+            } else if (line[0] == "TEXT") {
+                section = TEXT;
+                hasText = true;
+                continue;
             } else if (line[0] == "CODE") {
                 section = CODE;
                 continue;
@@ -114,10 +166,31 @@ int Linker::parseTables() {
                     defTable[label] = addr;
                     definedSymbols.insert(label);
                 }
+            } else if (section == BSS) {
+                // BSS holds the number of zeroed words that follow the code
+                if (line.size() != 1 || !std::regex_match(line[0], natRegEx)) {
+                    errMsg = genErrMsg(fileName, "BSS section must hold a single natural number");
+                    return error;
+                }
+                bssSizeMap[fileName] += std::stoul(line[0]);
+            } else if (section == WORD) {
+                // Width of the words of the module; objects without this section have 16-bit words
+                if (line.size() != 1 || (line[0] != "16" && line[0] != "32")) {
+                    errMsg = genErrMsg(fileName, "WORD section must hold 16 or 32");
+                    return error;
+                }
+                wordBitsMap[fileName] = std::stoul(line[0]);
+            } else if (section == TEXT) {
+                // Each line is a range of instruction words: start and size
+                if (line.size() != 2 || !std::regex_match(line[0], natRegEx) || !std::regex_match(line[1], natRegEx)) {
+                    errMsg = genErrMsg(fileName, "TEXT section lines must be of the form: START SIZE");
+                    return error;
+                }
+                textRangesMap[fileName].push_back(std::make_pair((unsigned int)std::stoul(line[0]), (unsigned int)std::stoul(line[1])));
             } else if (section == REL || section == CODE) {
                 for (auto addr : line) {
-                    // Check if addr is valid
-                    if (!std::regex_match(addr, natRegEx)) {
+                    // Check if addr is valid (code words may be negative constants)
+                    if (!std::regex_match(addr, section == CODE ? intRegEx : natRegEx)) {
                         errMsg = genErrMsg(fileName, "invalid memory address in RELATIVE section: " + addr);
                         return error;
                     }
@@ -131,62 +204,447 @@ int Linker::parseTables() {
                 }
             }
         }
+        if (!hasText) {
+            errMsg = genErrMsg(fileName, "has no TEXT section; assemble it again");
+            return error;
+        }
         useTables[fileName] = useTable;
         defTables[fileName] = defTable;
+    }
+
+    // Relocated and external words are fixed up in place, possibly by several threads at
+    // once, so they must lie within the module's own code
+    for (auto fileName : srcFileNames) {
+        size_t size = machineCode[fileName].size();
+        for (auto relAddr : relativeListMap[fileName]) {
+            if (relAddr >= size) {
+                errMsg = genErrMsg(fileName, "RELATIVE address " + std::to_string(relAddr) + " is past the code (" +
+                                   std::to_string(size) + " words)");
+                return error;
+            }
+        }
+        for (auto kvPair : useTables[fileName]) {
+            for (auto useAddr : kvPair.second) {
+                if (useAddr >= size) {
+                    errMsg = genErrMsg(fileName, "TABLE USE address " + std::to_string(useAddr) + " of " + kvPair.first +
+                                       " is past the code (" + std::to_string(size) + " words)");
+                    return error;
+                }
+            }
+        }
+    }
+
+    // TEXT ranges must be in order and within the code
+    for (auto fileName : srcFileNames) {
+        unsigned long end = 0;
+        for (auto range : textRangesMap[fileName]) {
+            if (range.first < end || (unsigned long)range.first + range.second > machineCode[fileName].size()) {
+                errMsg = genErrMsg(fileName, "TEXT range " + std::to_string(range.first) + ' ' + std::to_string(range.second) +
+                                   " overlaps another or lies past the code");
+                return error;
+            }
+            end = (unsigned long)range.first + range.second;
+        }
+    }
+
+    // Every module must use the same word width
+    for (auto fileName : srcFileNames) {
+        unsigned int bits = wordBitsMap.count(fileName) > 0 ? wordBitsMap[fileName] : 16;
+        if (fileName == srcFileNames.front()) {
+            linkedWordBits = bits;
+        } else if (bits != linkedWordBits) {
+            errMsg = genErrMsg(fileName, "has " + std::to_string(bits) + "-bit words but " + srcFileNames.front() +
+                               " has " + std::to_string(linkedWordBits) + "-bit words");
+            return error;
+        }
+    }
+
+    // Code of each module is placed right after the previous one
+    unsigned int byteOffset = 0;
+    for (auto fileName : srcFileNames) {
         sizeMap[fileName] = machineCode[fileName].size();
         byteOffsetMap[fileName] = byteOffset;
         byteOffset += machineCode[fileName].size();
     }
 
+    // BSS of each module is placed after the code of all of them
+    unsigned int bssOffset = byteOffset;
+    for (auto fileName : srcFileNames) {
+        bssOffsetMap[fileName] = bssOffset;
+        bssOffset += bssSizeMap[fileName];
+    }
+    linkedBss = bssOffset - byteOffset;
+
+    // Addresses past the limit would not fit in the words that hold them
+    unsigned long addressLimit = 1ul << (linkedWordBits - 1);
+    if (bssOffset > addressLimit) {
+        errMsg = genErrMsg(outputName + ".e", "linked program takes " + std::to_string(bssOffset) + " words, more than " +
+                           std::to_string(addressLimit) + " can be addressed with " + std::to_string(linkedWordBits) + "-bit words");
+        return error;
+    }
+
     return 0;
 }
 
-int Linker::link() {
+unsigned int Linker::relocate(const std::string& fileName, unsigned int addr) const {
+    // Module addresses past its code fall in its BSS (const lookups, so link() workers may share it)
+    unsigned int size = sizeMap.at(fileName);
+    if (addr < size) {
+        return addr + byteOffsetMap.at(fileName);
+    }
+    return addr - size + bssOffsetMap.at(fileName);
+}
+
+int Linker::link(unsigned int nThreads) {
     if (error) {
         return error;
     }
 
     // Build global definition table
-    std::map<std::string, unsigned int> globalDefTable;
     for (auto fileName : srcFileNames) {
         for (auto kvPair : defTables[fileName]) {
             auto label = kvPair.first;
-            auto addr = kvPair.second + byteOffsetMap[fileName];
+            auto addr = relocate(fileName, kvPair.second);
             globalDefTable[label] = addr;
         }
     }
 
-    // Apply correction to relative addresses
+    // Check that every cross-reference resolves before anything is written
+    for (auto fileName : srcFileNames) {
+        for (auto kvPair : useTables[fileName]) {
+            if (!kvPair.second.empty() && globalDefTable.count(kvPair.first) == 0) {
+                errMsg = genErrMsg(fileName, "undefined symbol " + kvPair.first);
+                return error;
+            }
+        }
+    }
+
+    // Image is allocated once and each module is fixed up in place in its own slice,
+    // so modules can be handled by several threads with no locking
+    std::vector<std::string> modules(srcFileNames.begin(), srcFileNames.end());
+    for (auto fileName : modules) {
+        relativeListMap[fileName];
+        useTables[fileName];
+    }
+    unsigned int codeSize = 0;
+    for (auto fileName : modules) {
+        codeSize += sizeMap[fileName];
+    }
+    linkedCode.assign(codeSize, 0);
+
+    std::atomic<size_t> nextModule(0);
+    auto task = [&]() {
+        for (size_t i = nextModule++; i < modules.size(); i = nextModule++) {
+            const std::string& fileName = modules[i];
+            const std::vector<int>& src = machineCode.at(fileName);
+            int* code = linkedCode.data() + byteOffsetMap.at(fileName);
+            std::copy(src.begin(), src.end(), code);
+
+            // Fix relative addresses
+            for (auto relAddr : relativeListMap.at(fileName)) {
+                code[relAddr] = relocate(fileName, src[relAddr]);
+            }
+
+            // Resolve cross-references
+            for (auto& kvPair : useTables.at(fileName)) {
+                unsigned int addr = globalDefTable.at(kvPair.first);
+                for (auto useAddr : kvPair.second) {
+                    code[useAddr] += addr;
+                }
+            }
+        }
+    };
+
+    if (nThreads == 0) {
+        nThreads = 1;
+    }
+    if (nThreads > modules.size()) {
+        nThreads = modules.size();
+    }
+    std::vector<std::thread> workers;
+    for (unsigned int i = 1; i < nThreads; ++i) {
+        workers.push_back(std::thread(task));
+    }
+    task();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    return 0;
+}
+
+int Linker::linkPartial() {
+    if (error) {
+        return error;
+    }
+
+    // Public symbols of all modules, at their addresses in the combined object
+    for (auto fileName : srcFileNames) {
+        for (auto kvPair : defTables[fileName]) {
+            auto addr = relocate(fileName, kvPair.second);
+            globalDefTable[kvPair.first] = addr;
+            partialObject.definitionTable.push_back(std::make_tuple(kvPair.first, (int)addr));
+        }
+    }
+
+    // Addresses stay relative to the start of the combined object, whose BSS
+    // is that of every module placed after all the code, as in a full link
     for (auto fileName : srcFileNames) {
-        // Copy file's machine code
         std::vector<int> code = machineCode[fileName];
+        unsigned int offset = byteOffsetMap[fileName];
 
-        // Fix relative addresses
         for (auto relAddr : relativeListMap[fileName]) {
-            code[relAddr] += byteOffsetMap[fileName];
+            code[relAddr] = relocate(fileName, code[relAddr]);
+            partialObject.relative.push_back(relAddr + offset);
         }
 
-        // Resolve cross-references
+        // Uses of symbols defined here become relative words, the others stay external
         for (auto kvPair : useTables[fileName]) {
             auto label = kvPair.first;
-            auto useList = kvPair.second;
-
-            for (auto useAddr : useList) {
-                // Check if symbol is defined
-                if (globalDefTable.count(label) == 0) {
-                    errMsg = genErrMsg(fileName, "undefined symbol " + label);
-                    return error;
+            for (auto useAddr : kvPair.second) {
+                if (globalDefTable.count(label) > 0) {
+                    code[useAddr] += globalDefTable[label];
+                    partialObject.relative.push_back(useAddr + offset);
+                } else {
+                    partialObject.useTable.push_back(std::make_tuple(label, (int)(useAddr + offset)));
                 }
-                code[useAddr] += globalDefTable[label];
             }
         }
 
-        linkedCode.insert(linkedCode.end(), code.begin(), code.end());
+        // TEXT and DATA of the modules alternate, so each module's TEXT ranges are kept
+        for (auto range : textRangesMap[fileName]) {
+            partialObject.text.push_back(std::make_pair(range.first + offset, range.second));
+        }
+
+        partialObject.code.insert(partialObject.code.end(), code.begin(), code.end());
+    }
+    partialObject.relative.sort();
+    partialObject.name = outputName;
+    partialObject.isModule = true;
+    partialObject.bss = linkedBss;
+    partialObject.wordBits = linkedWordBits;
+
+    return 0;
+}
+
+int Linker::writePartial() {
+    if (error) {
+        return error;
+    }
+
+    if (writeObject(outputName + ".obj", partialObject)) {
+        errMsg = genErrMsg(outputName + ".obj", "could not write object");
+        return error;
+    }
+
+    return 0;
+}
+
+void Linker::setOutputName(std::string outputName) {
+    this->outputName = outputName;
+}
+
+bool Linker::inText(const std::string& fileName, unsigned int addr) {
+    for (auto range : textRangesMap[fileName]) {
+        if (addr >= range.first && addr - range.first < range.second) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// TEXT ranges hold nothing but instructions, so walking each one from its start finds every operand
+void Linker::scanText(std::string fileName, std::vector<std::pair<unsigned int, int>>* operands) {
+    auto& code = machineCode[fileName];
+    std::set<unsigned int> operandAddrs;
+    for (auto range : textRangesMap[fileName]) {
+        unsigned int addr = range.first;
+        unsigned int end = range.first + range.second;
+        while (addr < end) {
+            int opcode = code[addr];
+            unsigned int length = isa::length(opcode);
+            if (length == 0 || addr + length > end) break;
+            for (unsigned int i = 1; i < length; ++i) {
+                operands->push_back(std::make_pair(addr + i, isa::operandKind(opcode, i - 1)));
+                operandAddrs.insert(addr + i);
+            }
+            addr += length;
+        }
+    }
+
+    std::set<unsigned int> refs(relativeListMap[fileName].begin(), relativeListMap[fileName].end());
+    for (auto kvPair : useTables[fileName]) {
+        refs.insert(kvPair.second.begin(), kvPair.second.end());
+    }
+    for (auto addr : refs) {
+        if (operandAddrs.count(addr) == 0) {
+            operands->push_back(std::make_pair(addr, (int)isa::NO_OPERAND));
+        }
+    }
+}
+
+LinkMap Linker::getMap() {
+    LinkMap map;
+    map.wordBits = linkedWordBits;
+
+    // Constants merged away shift everything after them, BSS included
+    unsigned int dropped = 0;
+    for (auto fileName : srcFileNames) {
+        MapModule module;
+        module.name = fileName;
+        module.base = byteOffsetMap[fileName] - dropped;
+        module.size = sizeMap[fileName] - droppedMap[fileName];
+        for (auto range : textRangesMap[fileName]) {
+            module.code += range.second;
+        }
+        module.data = module.size - module.code;
+        module.bssBase = bssOffsetMap[fileName] - mergedConstants;
+        module.bss = bssSizeMap[fileName];
+        dropped += droppedMap[fileName];
+
+        map.code += module.code;
+        map.data += module.data;
+        map.bss += module.bss;
+        map.modules.push_back(module);
+    }
+
+    // Uses are the words that refer to a symbol: from other modules through their USE
+    // tables, and from its own module as relative words holding its address
+    std::map<std::string, unsigned int> useCount;
+    std::map<std::string, std::map<unsigned int, unsigned int>> localUseCount;
+    for (auto fileName : srcFileNames) {
+        for (auto kvPair : useTables[fileName]) {
+            useCount[kvPair.first] += kvPair.second.size();
+        }
+        auto& code = machineCode[fileName];
+        for (auto relAddr : relativeListMap[fileName]) {
+            ++localUseCount[fileName][(unsigned int)code[relAddr]];
+        }
+    }
+    for (auto fileName : srcFileNames) {
+        for (auto kvPair : defTables[fileName]) {
+            MapSymbol symbol;
+            symbol.label = kvPair.first;
+            symbol.address = globalDefTable[kvPair.first];
+            if (inText(fileName, kvPair.second)) {
+                symbol.section = "code";
+            } else if (kvPair.second < sizeMap[fileName]) {
+                symbol.section = "data";
+            } else {
+                symbol.section = "bss";
+            }
+            symbol.module = fileName;
+            symbol.uses = useCount[kvPair.first] + localUseCount[fileName][kvPair.second];
+            map.symbols.push_back(symbol);
+        }
+    }
+    std::stable_sort(map.symbols.begin(), map.symbols.end(), [](const MapSymbol& a, const MapSymbol& b) {
+        return a.address < b.address;
+    });
+
+    return map;
+}
+
+int Linker::mergeConstants() {
+    if (error) {
+        return error;
+    }
+    unsigned int codeSize = linkedCode.size();
+    unsigned int imageSize = codeSize + linkedBss;
+
+    std::vector<std::pair<unsigned int, int>> operands;  // linked position and operand kind
+    std::vector<bool> isText(codeSize, false);
+    for (auto fileName : srcFileNames) {
+        std::vector<std::pair<unsigned int, int>> textOperands;
+        scanText(fileName, &textOperands);
+        unsigned int offset = byteOffsetMap[fileName];
+        for (auto operand : textOperands) {
+            operands.push_back(std::make_pair(offset + operand.first, operand.second));
+        }
+        for (auto range : textRangesMap[fileName]) {
+            for (unsigned int i = 0; i < range.second; ++i) {
+                isText[offset + range.first + i] = true;
+            }
+        }
+    }
+
+    // Words that are written or jumped to keep their own copy, and so do addresses kept
+    // in DATA and the words they point at. A write into TEXT means the program may build
+    // its own operands, so nothing is merged at all
+    std::vector<bool> isPinned(codeSize, false);
+    for (auto operand : operands) {
+        if (!isText[operand.first]) {
+            isPinned[operand.first] = true;
+        }
+        unsigned int target = linkedCode[operand.first];
+        if (target >= imageSize) {
+            return 0;
+        }
+        if (target >= codeSize) continue;
+        if (operand.second == isa::WRITE && isText[target]) {
+            return 0;
+        }
+        if (operand.second != isa::READ) {
+            isPinned[target] = true;
+        }
+    }
+
+    // First copy of each read-only value is kept and the others are dropped
+    std::map<int, unsigned int> firstCopy;
+    std::vector<unsigned int> newAddr(imageSize);
+    std::vector<bool> isDropped(codeSize, false);
+    unsigned int dropped = 0;
+    for (unsigned int addr = 0; addr < codeSize; ++addr) {
+        if (!isText[addr] && !isPinned[addr]) {
+            auto it = firstCopy.find(linkedCode[addr]);
+            if (it != firstCopy.end()) {
+                newAddr[addr] = newAddr[it->second];
+                isDropped[addr] = true;
+                ++dropped;
+                continue;
+            }
+            firstCopy[linkedCode[addr]] = addr;
+        }
+        newAddr[addr] = addr - dropped;
+    }
+    for (unsigned int addr = codeSize; addr < imageSize; ++addr) {
+        newAddr[addr] = addr - dropped;
+    }
+    if (dropped == 0) {
+        return 0;
+    }
+
+    // Operands and public symbols follow the words they point at
+    for (auto operand : operands) {
+        linkedCode[operand.first] = newAddr[linkedCode[operand.first]];
+    }
+    for (auto& kvPair : globalDefTable) {
+        if (kvPair.second < imageSize) {
+            kvPair.second = newAddr[kvPair.second];
+        }
+    }
+    unsigned int next = 0;
+    for (unsigned int addr = 0; addr < codeSize; ++addr) {
+        if (!isDropped[addr]) {
+            linkedCode[next++] = linkedCode[addr];
+        }
+    }
+    linkedCode.resize(next);
+    mergedConstants = dropped;
+    for (auto fileName : srcFileNames) {
+        unsigned int offset = byteOffsetMap[fileName];
+        for (unsigned int addr = offset; addr < offset + sizeMap[fileName]; ++addr) {
+            droppedMap[fileName] += isDropped[addr] ? 1 : 0;
+        }
     }
 
     return 0;
 }
 
+unsigned int Linker::getMergedConstants() {
+    return mergedConstants;
+}
+
 int Linker::printTables() {
     if (error) {
         return error;
@@ -194,6 +652,9 @@ int Linker::printTables() {
 
     for (auto fileName : srcFileNames) {
         std::cout << fileName + " size: " + std::to_string(sizeMap[fileName]) + '\n';
+        if (bssSizeMap[fileName] > 0) {
+            std::cout << fileName + " bss: " + std::to_string(bssSizeMap[fileName]) + '\n';
+        }
         auto useMap = useTables[fileName];
         std::cout << "TABLE USE\n";
         for (auto kvPair : useMap) {
@@ -232,6 +693,22 @@ int Linker::printTables() {
     return 0;
 }
 
+const std::vector<int>& Linker::getCode() {
+    return linkedCode;
+}
+
+unsigned int Linker::getBss() {
+    return linkedBss;
+}
+
+unsigned int Linker::getWordBits() {
+    return linkedWordBits;
+}
+
+const std::map<std::string, unsigned int>& Linker::getSymbols() {
+    return globalDefTable;
+}
+
 int Linker::printOutput() {
     if (error) {
         return error;
@@ -240,23 +717,23 @@ int Linker::printOutput() {
     for (auto word : linkedCode) {
         std::cout << std::to_string(word) + ' ';
     }
+    for (unsigned int i = 0; i < linkedBss; ++i) {
+        std::cout << "0 ";
+    }
     std::cout << '\n';
     return 0;
 }
 
-int Linker::writeOutput() {
+int Linker::writeOutput(bool binary) {
     if (error) {
         return error;
     }
 
-    // Write executable file
-    std::ofstream outFile;
-    outFile.open(outputName + ".e");
-    for (auto word : linkedCode) {
-        outFile << std::to_string(word) + ' ';
+    // Write executable file, as text unless the binary format was requested
+    if (writeExecutable(outputName + ".e", linkedCode, binary, 0, linkedBss, linkedWordBits)) {
+        errMsg = genErrMsg(outputName + ".e", "could not write executable");
+        return error;
     }
-    outFile << '\n';
-    outFile.close();
 
     return 0;
 }
@@ -0,0 +1,171 @@
+#include <map.hpp>
+
+#include <fstream>
+#include <map>
+#include <sstream>
+
+#include <utils.hpp>
+
+static void writeText(std::ostream& out, const LinkMap& map) {
+    out << "# MAP <word-bits>\n"
+        << "# MODULE <name> <base> <size> <code> <data> <bss-base> <bss>\n"
+        << "# SYMBOL <label> <address> <section> <module> <uses>\n"
+        << "# TOTAL <size> <code> <data> <bss>\n"
+        << "MAP " << map.wordBits << '\n';
+    for (auto& module : map.modules) {
+        out << "MODULE " << module.name << ' ' << module.base << ' ' << module.size << ' '
+            << module.code << ' ' << module.data << ' ' << module.bssBase << ' ' << module.bss << '\n';
+    }
+    for (auto& symbol : map.symbols) {
+        out << "SYMBOL " << symbol.label << ' ' << symbol.address << ' ' << symbol.section << ' '
+            << symbol.module << ' ' << symbol.uses << '\n';
+    }
+    out << "TOTAL " << map.code + map.data + map.bss << ' ' << map.code << ' ' << map.data << ' ' << map.bss << '\n';
+}
+
+// Labels and file names have no quotes or control characters worth more than this
+static std::string quote(std::string text) {
+    std::string quoted = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') quoted += '\\';
+        quoted += c;
+    }
+    return quoted + '"';
+}
+
+static void writeJson(std::ostream& out, const LinkMap& map) {
+    out << "{\n  \"wordBits\": " << map.wordBits << ",\n  \"modules\": [";
+    for (size_t i = 0; i < map.modules.size(); ++i) {
+        auto& module = map.modules[i];
+        out << (i > 0 ? "," : "") << "\n    {\"name\": " << quote(module.name) << ", \"base\": " << module.base
+            << ", \"size\": " << module.size << ", \"code\": " << module.code << ", \"data\": " << module.data
+            << ", \"bssBase\": " << module.bssBase << ", \"bss\": " << module.bss << "}";
+    }
+    out << "\n  ],\n  \"symbols\": [";
+    for (size_t i = 0; i < map.symbols.size(); ++i) {
+        auto& symbol = map.symbols[i];
+        out << (i > 0 ? "," : "") << "\n    {\"label\": " << quote(symbol.label) << ", \"address\": " << symbol.address
+            << ", \"section\": " << quote(symbol.section) << ", \"module\": " << quote(symbol.module)
+            << ", \"uses\": " << symbol.uses << "}";
+    }
+    out << "\n  ],\n  \"total\": {\"size\": " << map.code + map.data + map.bss << ", \"code\": " << map.code
+        << ", \"data\": " << map.data << ", \"bss\": " << map.bss << "}\n}\n";
+}
+
+int writeMap(std::string fileName, const LinkMap& map) {
+    std::ofstream outFile(fileName);
+    if (!outFile.is_open()) {
+        return 1;
+    }
+    if (isSuffix(fileName, ".json")) {
+        writeJson(outFile, map);
+    } else {
+        writeText(outFile, map);
+    }
+    outFile.close();
+    return outFile.fail() ? 1 : 0;
+}
+
+int readMap(std::string fileName, LinkMap* map, std::string* errMsg) {
+    std::ifstream inFile(fileName);
+    if (!inFile.is_open()) {
+        *errMsg = "could not read " + fileName;
+        return 1;
+    }
+    *map = LinkMap();
+    std::string line;
+    int lineCount = 0;
+    bool hasHeader = false;
+    while (std::getline(inFile, line)) {
+        ++lineCount;
+        std::istringstream tokens(line);
+        std::string kind;
+        if (!(tokens >> kind) || kind[0] == '#') continue;
+        bool ok;
+        if (kind == "MAP") {
+            ok = (bool)(tokens >> map->wordBits);
+            hasHeader = true;
+        } else if (kind == "MODULE") {
+            MapModule module;
+            ok = (bool)(tokens >> module.name >> module.base >> module.size >> module.code >> module.data
+                               >> module.bssBase >> module.bss);
+            map->modules.push_back(module);
+        } else if (kind == "SYMBOL") {
+            MapSymbol symbol;
+            ok = (bool)(tokens >> symbol.label >> symbol.address >> symbol.section >> symbol.module >> symbol.uses);
+            map->symbols.push_back(symbol);
+        } else if (kind == "TOTAL") {
+            unsigned int size;
+            ok = (bool)(tokens >> size >> map->code >> map->data >> map->bss);
+        } else {
+            ok = false;
+        }
+        if (!ok || !hasHeader) {
+            *errMsg = fileName + ": line " + std::to_string(lineCount) + ": not a text link map";
+            return 1;
+        }
+    }
+    if (!hasHeader) {
+        *errMsg = fileName + " is not a text link map";
+        return 1;
+    }
+    return 0;
+}
+
+static void diffValue(std::ostream& out, std::string what, unsigned int before, unsigned int after) {
+    if (before == after) return;
+    long delta = (long)after - (long)before;
+    out << what << ": " << before << " -> " << after << " (" << (delta > 0 ? "+" : "") << delta << ")\n";
+}
+
+void diffMaps(const LinkMap& before, const LinkMap& after, std::ostream& out) {
+    diffValue(out, "size", before.code + before.data + before.bss, after.code + after.data + after.bss);
+    diffValue(out, "code", before.code, after.code);
+    diffValue(out, "data", before.data, after.data);
+    diffValue(out, "bss", before.bss, after.bss);
+
+    // Modules are matched by name, symbols by label; addresses shift with any size
+    // change, so only sizes and use counts are compared
+    std::map<std::string, MapModule> oldModules;
+    for (auto& module : before.modules) {
+        oldModules[module.name] = module;
+    }
+    for (auto& module : after.modules) {
+        auto it = oldModules.find(module.name);
+        if (it == oldModules.end()) {
+            out << "module " << module.name << " added: size " << module.size << ", bss " << module.bss << '\n';
+            continue;
+        }
+        diffValue(out, "module " + module.name + " size", it->second.size, module.size);
+        diffValue(out, "module " + module.name + " code", it->second.code, module.code);
+        diffValue(out, "module " + module.name + " data", it->second.data, module.data);
+        diffValue(out, "module " + module.name + " bss", it->second.bss, module.bss);
+        oldModules.erase(it);
+    }
+    for (auto& kvPair : oldModules) {
+        out << "module " << kvPair.first << " removed: size " << kvPair.second.size << ", bss " << kvPair.second.bss << '\n';
+    }
+
+    std::map<std::string, MapSymbol> oldSymbols;
+    for (auto& symbol : before.symbols) {
+        oldSymbols[symbol.label] = symbol;
+    }
+    for (auto& symbol : after.symbols) {
+        auto it = oldSymbols.find(symbol.label);
+        if (it == oldSymbols.end()) {
+            out << "symbol " << symbol.label << " added in " << symbol.module << '\n';
+            continue;
+        }
+        if (it->second.module != symbol.module) {
+            out << "symbol " << symbol.label << " moved: " << it->second.module << " -> " << symbol.module << '\n';
+        }
+        if (it->second.section != symbol.section) {
+            out << "symbol " << symbol.label << " section: " << it->second.section << " -> " << symbol.section << '\n';
+        }
+        diffValue(out, "symbol " + symbol.label + " uses", it->second.uses, symbol.uses);
+        oldSymbols.erase(it);
+    }
+    for (auto& kvPair : oldSymbols) {
+        out << "symbol " << kvPair.first << " removed from " << kvPair.second.module << '\n';
+    }
+}
@@ -1,91 +1,97 @@
 #include <algorithm>
 #include <fstream>
+#include <functional>
 #include <iostream>
 #include <list>
 #include <map>
+#include <memory>
 #include <string>
 #include <tuple>
+#include <unordered_map>
+#include <vector>
 #include <regex>
 #include <set>
 
+#include <executable.hpp>
+#include <isa.hpp>
+#include <object.hpp>
+#include <preprocessor.hpp>
 #include <utils.hpp>
 
 class Assembler {
     private:
         std::regex intRegEx = std::regex("(\\+|-)?[0-9]+");
-        std::regex hexRegEx = std::regex("0(x|X)[0-9a-f]{1,4}");
+        std::regex hexRegEx = std::regex("0(x|X)[0-9a-fA-F]{1," + std::to_string(WORD_BITS / 4) + "}");
         std::regex natRegEx = std::regex("[0-9]+");
+        std::regex labelRegEx = std::regex("[a-zA-Z_][a-zA-Z0-9_]*");
         std::string fileName;
         std::list<std::tuple<int, std::list<std::string>>> srcLines;
+        // Names of the files included by the source, for error messages
+        std::vector<std::string> includedFiles;
         std::map<std::string, int> symbolsMap;
         std::set<std::string> externSymbols;
         std::list<std::tuple<std::string, int>> useTable;
         std::list<std::tuple<std::string, int>> definitionTable;
         std::list<unsigned int> relative;
-        std::list<short> machineCode;
+        std::vector<isa::Word> machineCode;
+        // Words emitted in SECTION TEXT, which comes first in the code
+        int textSize = 0;
         std::set<std::string> zeroList;
         std::set<std::string> invalidJumpList;
         bool isModule = false;
-        enum {
-            ADD = 1,
-            SUB,
-            MULT,
-            DIV,
-            JMP,
-            JMPN,
-            JMPP,
-            JMPZ,
-            COPY,
-            LOAD,
-            STORE,
-            INPUT,
-            OUTPUT,
-            STOP,
+        // SPACE reservations are only counted: BSS goes after all TEXT and DATA words
+        // and its labels are shifted past them once the code size is known
+        std::set<std::string> bssSymbols;
+        int bssSize = 0;
+        // Single-pass symbol records, each holding the indices of the code words
+        // that wait for its address until the label is defined
+        struct Symbol {
+            int addr;
+            bool defined;
+            bool isExtern;
+            bool isZero;
+            bool isData;
+            bool isBss;
+            std::vector<size_t> fixups;
         };
-        const std::map<std::string, short> opcodeMap = {
-            {"ADD", 1},
-            {"SUB", 2},
-            {"MULT", 3},
-            {"DIV", 4},
-            {"JMP", 5},
-            {"JMPN", 6},
-            {"JMPP", 7},
-            {"JMPZ", 8},
-            {"COPY", 9},
-            {"LOAD", 10},
-            {"STORE", 11},
-            {"INPUT", 12},
-            {"OUTPUT", 13},
-            {"STOP", 14}
-        };
-        const std::map<std::string, int> memSpaceMap = {
-            {"ADD", 2},
-            {"SUB", 2},
-            {"MULT", 2},
-            {"DIV", 2},
-            {"JMP", 2},
-            {"JMPN", 2},
-            {"JMPP", 2},
-            {"JMPZ", 2},
-            {"COPY", 3},
-            {"LOAD", 2},
-            {"STORE", 2},
-            {"INPUT", 2},
-            {"OUTPUT", 2},
-            {"STOP", 1},
-            {"PUBLIC", 0}
+        // Operand uses and PUBLIC lines, checked in source order once all symbols are known
+        struct SymbolRef {
+            int lineCount;
+            int check;
+            int addr;
+            std::unordered_map<std::string, Symbol>::value_type* symbol;
         };
+        std::unordered_map<std::string, Symbol> symbolRecords;
+        std::vector<SymbolRef> symbolRefs;
+        // Parallel assembly: state a chunk of lines starts in, the line each
+        // label was defined at and the chunk's size after the first pass
+        bool isChunk = false;
+        int startSection = 0;
+        bool startHadText = false;
+        bool startModuleEnded = false;
+        std::map<std::string, int> symbolLines;
+        int memSize = 0;
         int error = 0;
+        int errLine = 0;
         std::string errMsg;
         std::string genErrMsg(int, std::string);
         void handleArgument(int, std::list<std::string>::iterator*, std::list<std::string>::iterator, int*);
+        std::unordered_map<std::string, Symbol>::value_type* findSymbol(const std::string&);
+        void emitArgument(int, int, std::list<std::string>::iterator*, std::list<std::string>::iterator);
+        int resolveDeferred();
+        int parseConst(int, std::string, int*);
+        int checkSize();
     public:
         Assembler(std::string, std::list<std::tuple<int, std::list<std::string>>>);
         int printSource();
         int printOutput();
-        int writeOutput();
+        int writeOutput(bool binary = false);
+        ObjectModule getObject();
         int firstPass();
         int secondPass();
+        int singlePass();
+        int parallelPass(unsigned int);
         int getError();
         std::string getErrorMessage();
+        void setIncludedFiles(const std::vector<std::string>&);
 };
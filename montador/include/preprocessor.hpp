@@ -1,21 +1,45 @@
+#pragma once
+
 #include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <list>
 #include <map>
+#include <memory>
 #include <string>
 #include <tuple>
+#include <vector>
 
+#include <reader.hpp>
 #include <utils.hpp>
 
+// Lines of included files are numbered (index << INCLUDE_LINE_BITS) + line, indices
+// counting from 1 in the order files were first included; main file lines keep their number
+const int INCLUDE_LINE_BITS = 20;
+
+// "line N" or "<included-file> line N"
+std::string describeLine(int, const std::vector<std::string>&);
+
 class PreProcessor {
    private:
     std::string fileName;
-    std::list<std::tuple<int, std::string>> srcLines;
+    std::unique_ptr<FileReader> reader;
+    std::vector<std::tuple<int, TextView>> srcLines;
     std::list<std::tuple<int, std::list<std::string>>> outLines;
     int error = 0;
+    void indexLines();
+    // EQU labels, shared by the file and everything it includes
+    std::map<std::string, int> equMap;
+    std::vector<std::string> includedFiles;
+    std::map<std::string, int> includeIndex;
+    std::vector<std::string> includeStack;
+    int processLine(int, std::list<std::string>, std::string, bool*);
+    int include(int, std::string, std::string);
    public:
+    // Directory where tokenized include files are kept by content hash; none by default
+    static void setIncludeCache(std::string);
     PreProcessor(std::string);
+    PreProcessor(std::string, std::string);
     ~PreProcessor();
     int printSource();
     int printOutput();
@@ -23,4 +47,5 @@ class PreProcessor {
     int preProcess();
     int getError();
     std::list<std::tuple<int, std::list<std::string>>> getOutput();
+    const std::vector<std::string>& getIncludedFiles();
 };
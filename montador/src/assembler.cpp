@@ -1,5 +1,8 @@
 #include <assembler.hpp>
 
+#include <climits>
+#include <thread>
+
 Assembler::Assembler(std::string fileName, std::list<std::tuple<int, std::list<std::string>>> srcLines) {
     this->fileName = fileName;
     this->srcLines = srcLines;
@@ -20,51 +23,41 @@ int Assembler::printSource() {
     return 0;
 }
 
-int Assembler::writeOutput() {
+int Assembler::writeOutput(bool binary) {
     if (error != 0) {
         return error;
     }
-    std::string objName;
-    if (isModule) {
-        objName = fileName + ".obj";  // output file name
-    } else {
-        objName = fileName + ".e";  // output file name
-    }
-    std::ofstream outFile;
-    outFile.open(objName);
-
-    if (isModule) {
-        // Write TABLE USE section to object file
-        outFile << "TABLE USE\n";
-        for (auto use : useTable) {
-            auto rot = std::get<0>(use);
-            auto addr = std::get<1>(use);
-            outFile << rot + ' ' + std::to_string(addr) + '\n';
-        }
 
-        // Write TABLE DEFINITION section to object file
-        outFile << "TABLE DEFINITION\n";
-        for (auto def : definitionTable) {
-            auto rot = std::get<0>(def);
-            auto addr = std::get<1>(def);
-            outFile << rot + ' ' + std::to_string(addr) + '\n';
+    // Programs without BEGIN/END are executables and may use the binary format
+    if (!isModule && binary) {
+        std::vector<int> words(machineCode.begin(), machineCode.end());
+        if (writeExecutable(fileName + ".e", words, true, 0, bssSize, WORD_BITS)) {
+            errMsg = "could not write " + fileName + ".e";
+            error = 1;
+            return error;
         }
-
-        // Write RELATIVE section to object file
-        outFile << "RELATIVE\n";
-        for (auto rel : relative) {
-            outFile << std::to_string(rel) + ' ';
+        return 0;
+    }
+    if (isModule) {
+        if (writeObject(fileName + ".obj", getObject())) {
+            errMsg = "could not write " + fileName + ".obj";
+            error = 1;
+            return error;
         }
-        if (!relative.empty()) outFile << '\n';
-
-        // Write CODE section to object file
-        outFile << "CODE\n";
+        return 0;
     }
 
+    std::ofstream outFile;
+    outFile.open(fileName + ".e");
+
     for (auto code : machineCode) {
         outFile << std::to_string(code) + " ";
     }
-    if (!machineCode.empty()) outFile << '\n';
+    // Text executables hold every word, so the BSS zeros are written out here
+    for (int i = 0; i < bssSize; ++i) {
+        outFile << "0 ";
+    }
+    if (!machineCode.empty() || bssSize > 0) outFile << '\n';
 
     outFile.close();
 
@@ -83,9 +76,10 @@ int Assembler::firstPass() {
         return error;
     }
     int memCount = 0;
-    int section = NONE;
-    bool moduleEnded = false;
-    bool hadText = false;
+    int bssCount = 0;
+    int section = startSection;
+    bool moduleEnded = startModuleEnded;
+    bool hadText = startHadText;
 
     for (auto lineIt = srcLines.begin(); lineIt != srcLines.end(); ++lineIt)
     {
@@ -134,7 +128,6 @@ int Assembler::firstPass() {
             label.pop_back(); // Remove ':' from the label
 
             // Check if label matches valid regular expression
-            std::regex labelRegEx("[a-zA-Z_][a-zA-Z0-9_]*");
             if (!std::regex_match(label, labelRegEx)) {
                 errMsg = genErrMsg(lineCount, "invalid label " + label);
                 error = 1;
@@ -149,7 +142,15 @@ int Assembler::firstPass() {
             }
 
             // If everything's ok, add symbol to symbols table
-            symbolsMap[label] = memCount;
+            if (section == BSS) {
+                symbolsMap[label] = bssCount;
+                bssSymbols.insert(label);
+            } else {
+                symbolsMap[label] = memCount;
+            }
+            if (isChunk) {
+                symbolLines[label] = lineCount;
+            }
 
             // If label is from sections DATA or BSS, make sure code is not jumping to it
             if (section == DATA || section == BSS) {
@@ -170,7 +171,7 @@ int Assembler::firstPass() {
                 if (nextTokenIt != line.end()) {
                     // Since an argument was given, check if it is valid
                     if (std::regex_match(*nextTokenIt, natRegEx)) {
-                        memCount += std::atoi((*nextTokenIt).c_str());
+                        (section == BSS ? bssCount : memCount) += std::atoi((*nextTokenIt).c_str());
                     } else {
                         errMsg = genErrMsg(lineCount, "invalid argument for SPACE directive: " + *nextTokenIt);
                         error = 1;
@@ -178,7 +179,7 @@ int Assembler::firstPass() {
                     }
                 } else {
                     // Since no argument was given, reserve only one space
-                    memCount += 1;
+                    (section == BSS ? bssCount : memCount) += 1;
                 }
             // If token is CONST, check if it is zero for handling division by 0
             } else if (token == "CONST") {
@@ -190,19 +191,7 @@ int Assembler::firstPass() {
                 }
 
                 int constVal;
-
-                // Check if given argument is decimal or hexadecimal
-                if(std::regex_match(*nextTokenIt, intRegEx)) {
-                    constVal = std::stoi(*nextTokenIt);
-                } else if (std::regex_match(*nextTokenIt, hexRegEx)) {
-                    // Convert to lower case if hexadecimal
-                    for(auto &c : *nextTokenIt) {
-                        c = std::tolower(c);
-                    }
-                    constVal = std::stoi(*nextTokenIt, 0, 16);
-                } else {
-                    errMsg = genErrMsg(lineCount, "invalid immediate " + *tokenIt);
-                    error = 1;
+                if (parseConst(lineCount, *nextTokenIt, &constVal)) {
                     return error;
                 }
                 memCount += 1;
@@ -223,6 +212,7 @@ int Assembler::firstPass() {
                 externSymbols.insert(label);
                 // Set label address to 0 (its true address will be set by linker)
                 symbolsMap[label] = 0;
+                bssSymbols.erase(label);
             // If token is BEGIN, handle errors and control flags as needed
             } else if (token == "BEGIN") {
                 // Check if already in a section
@@ -262,26 +252,36 @@ int Assembler::firstPass() {
                 }
                 section = NONE;
                 moduleEnded = true;
-            } else {
+            } else if (token != "PUBLIC") {
                 // Since instruction/directive was not handled above, check if it is defined
-                if(memSpaceMap.count(token) == 0) {
+                int opcode = isa::lookup(token);
+                if (opcode == isa::INVALID) {
                     errMsg = genErrMsg(lineCount, "instruction/directive " + token + " not defined");
                     error = 1;
                     return error;
                 }
-                // If defined, reserve space for the instruction/directive accordingly
-                memCount += memSpaceMap.at(token);
+                // If defined, reserve space for the instruction accordingly
+                memCount += isa::length(opcode);
             }
         }
     }
 
     // Check if TEXT section was declared
-    if (!hadText) {
+    if (!hadText && !isChunk) {
         errMsg = "TEXT section not found";
         error = 1;
         return error;
     }
 
+    // Chunks are placed by parallelPass, which knows the size of the whole file
+    if (!isChunk) {
+        for (auto& label : bssSymbols) {
+            symbolsMap[label] += memCount;
+        }
+    }
+
+    memSize = memCount;
+    bssSize = bssCount;
     return 0;
 }
 
@@ -291,7 +291,7 @@ int Assembler::secondPass() {
     }
 
     int memCount = 0;
-    int section = NONE;
+    int section = startSection;
 
     for (auto lineIt = srcLines.begin(); lineIt != srcLines.end(); ++lineIt)
     {
@@ -414,19 +414,9 @@ int Assembler::secondPass() {
                     return error;
                 }
 
-                int nSpaces;
-                // Set nSpaces var according to argument given
+                // The space itself was counted in the first pass and takes no code
                 if (std::next(tokenIt) != line.end()) {
                     ++tokenIt;
-                    nSpaces = std::atoi((*tokenIt).c_str());
-                } else {
-                    nSpaces = 1;
-                }
-
-                // Reserve memory space according to nSpaces
-                for (;nSpaces > 0; --nSpaces) {
-                    ++memCount;
-                    machineCode.push_back(0);
                 }
 
                 // Check if there's any unexpected token after SPACE
@@ -447,19 +437,11 @@ int Assembler::secondPass() {
                 // Advance tokenIt to argument
                 ++tokenIt;
 
-                // Check if given argument is decimal or hexadecimal
-                if(std::regex_match(*tokenIt, intRegEx)) {
-                    machineCode.push_back(std::atoi((*tokenIt).c_str()));
-                } else if (std::regex_match(*tokenIt, hexRegEx)) {
-                    // Convert to lower case if hexadecimal
-                    for(auto &c : *tokenIt) {
-                        c = std::tolower(c);
-                    }
-                    machineCode.push_back(std::stoi(*tokenIt, 0, 16));
-                } else {
-                    errMsg = genErrMsg(lineCount, "invalid immediate " + *tokenIt);
+                int constVal;
+                if (parseConst(lineCount, *tokenIt, &constVal)) {
                     return error;
                 }
+                machineCode.push_back(constVal);
 
                 // Reserve memory space for constant value
                 ++memCount;
@@ -479,30 +461,31 @@ int Assembler::secondPass() {
                 }
 
                 // Check if instruction is defined in instructions map
-                if (opcodeMap.count(op) == 0) {
+                int opcode = isa::lookup(op);
+                if (opcode == isa::INVALID) {
                     errMsg = genErrMsg(lineCount, "unknown " + op + " operator");
                     return error;
                 }
-                short opcode = opcodeMap.at(op);
 
                 // Add instruction opcode to code
                 machineCode.push_back(opcode);
+                textSize = machineCode.size() - 1 + isa::length(opcode);
                 ++memCount;
 
                 // Handle arguments according to which instruction was given
                 switch (opcode) {
-                case DIV:
-                case ADD:
-                case SUB:
-                case MULT:
-                case JMP:
-                case JMPN:
-                case JMPP:
-                case JMPZ:
-                case LOAD:
-                case STORE:
-                case INPUT:
-                case OUTPUT:
+                case isa::DIV:
+                case isa::ADD:
+                case isa::SUB:
+                case isa::MULT:
+                case isa::JMP:
+                case isa::JMPN:
+                case isa::JMPP:
+                case isa::JMPZ:
+                case isa::LOAD:
+                case isa::STORE:
+                case isa::INPUT:
+                case isa::OUTPUT:
                     // These instructions take a single defined symbol as argument
 
                     // Check if argument was given
@@ -515,17 +498,13 @@ int Assembler::secondPass() {
                     ++tokenIt;
 
                     // Check division by zero
-                    if (opcode == DIV && zeroList.count(*tokenIt) > 0) {
+                    if (opcode == isa::DIV && zeroList.count(*tokenIt) > 0) {
                         errMsg = genErrMsg(lineCount, "division by zero");
                         return error;
                     }
 
                     // Check invalid jump
-                    if ((opcode == JMP ||
-                         opcode == JMPN ||
-                         opcode == JMPP ||
-                         opcode == JMPZ)
-                         && invalidJumpList.count(*tokenIt) > 0) {
+                    if (isa::isJump(opcode) && invalidJumpList.count(*tokenIt) > 0) {
                         errMsg = genErrMsg(lineCount, "jump to label " + *tokenIt + " in invalid section");
                         return error;
                     }
@@ -541,7 +520,7 @@ int Assembler::secondPass() {
                     }
 
                     break;
-                case COPY:
+                case isa::COPY:
                     // COPY takes 2 arguments, possibly comma-separated
                     // Check if first argument was given
                     if (std::next(tokenIt) == line.end()) {
@@ -576,7 +555,7 @@ int Assembler::secondPass() {
                         return error;
                     }
                     break;
-                case STOP:
+                case isa::STOP:
                     // STOP does not take any arguments
                     // Check if an argument was given
                     if (std::next(tokenIt) != line.end()) {
@@ -591,20 +570,581 @@ int Assembler::secondPass() {
         }
     }
 
-    return 0;
+    return checkSize();
+}
+
+enum {
+    CHECK_DEFINED = 0,
+    CHECK_DIV,
+    CHECK_JUMP,
+    CHECK_PUBLIC
+};
+
+int Assembler::singlePass() {
+    if (error != 0) {
+        return error;
+    }
+    int memCount = 0;
+    int bssCount = 0;
+    int section = NONE;
+    bool moduleEnded = false;
+    bool hadText = false;
+
+    for (auto lineIt = srcLines.begin(); lineIt != srcLines.end(); ++lineIt)
+    {
+        auto& line = std::get<1>(*lineIt);
+        auto lineCount = std::get<0>(*lineIt);
+
+        // Handle section change
+        if (line.front() == "SECTION") {
+            // Section lines must always have 2 tokens (SECTION <section_name>)
+            if (line.size() != 2) {
+                errMsg = genErrMsg(lineCount, "section lines must always have 2 tokens");
+                return error;
+            }
+            // Change the section variable according to the second token
+            if (line.back() == "TEXT") {
+                if (hadText) {
+                    errMsg = genErrMsg(lineCount, "SECTION TEXT must not be split inside a module");
+                    return error;
+                }
+                section = TEXT;
+                hadText = true;
+            } else if (section == NONE) {
+                errMsg = genErrMsg(lineCount, "SECTION TEXT must be the first section inside a module");
+                return error;
+            } else if (line.back() == "DATA") {
+                section = DATA;
+            } else if (line.back() == "BSS") {
+                section = BSS;
+            } else {
+                errMsg = genErrMsg(lineCount, "unknown section name " + line.back());
+                return error;
+            }
+            continue;
+        }
+
+        // Get iterator to the first token in line
+        auto tokenIt = line.begin();
+
+        // If line begins with label
+        Symbol* labelSymbol = nullptr;
+        auto label = line.front();
+        if (isSuffix(label, ":")) {
+            label.pop_back(); // Remove ':' from the label
+
+            // Check if label matches valid regular expression
+            if (!std::regex_match(label, labelRegEx)) {
+                errMsg = genErrMsg(lineCount, "invalid label " + label);
+                return error;
+            }
+
+            // Check if label already exists
+            labelSymbol = &findSymbol(label)->second;
+            if (labelSymbol->defined) {
+                errMsg = genErrMsg(lineCount, "symbol redefinition");
+                return error;
+            }
+
+            // Advance to second token in line
+            ++tokenIt;
+
+            // EXTERN labels are placed at 0 (their true address will be set by linker)
+            bool isExtern = tokenIt != line.end() && *tokenIt == "EXTERN";
+            labelSymbol->defined = true;
+            if (section == BSS && !isExtern) {
+                // BSS addresses are final only once the code size is known
+                labelSymbol->addr = bssCount;
+                labelSymbol->isBss = true;
+            } else {
+                labelSymbol->addr = isExtern ? 0 : memCount;
+
+                // Patch every forward reference waiting for this label
+                for (auto index : labelSymbol->fixups) {
+                    machineCode[index] += labelSymbol->addr;
+                }
+                labelSymbol->fixups.clear();
+            }
+
+            // If label is from sections DATA or BSS, make sure code is not jumping to it
+            if (section == DATA || section == BSS) {
+                labelSymbol->isData = true;
+            }
+        }
+
+        // Line holds only a label
+        if (tokenIt == line.end()) {
+            continue;
+        }
+
+        auto op = *tokenIt;
+        if (op == "EXTERN") {
+            // Check if label was defined
+            if (labelSymbol == nullptr) {
+                errMsg = genErrMsg(lineCount, "EXTERN directive requires label");
+                return error;
+            }
+            if (!isModule) {
+                errMsg = genErrMsg(lineCount, "cannot use EXTERN directive outside a module");
+                return error;
+            }
+            // EXTERN does not require arguments
+            if (std::next(tokenIt) != line.end()) {
+                errMsg = genErrMsg(lineCount, "expecting newline, found " + *std::next(tokenIt));
+                return error;
+            }
+            labelSymbol->isExtern = true;
+            continue;
+        }
+        if (op == "PUBLIC") {
+            if (!isModule) {
+                errMsg = genErrMsg(lineCount, "cannot use PUBLIC directive outside a module");
+                return error;
+            }
+            // PUBLIC requires a single symbol as argument
+            if (std::next(tokenIt) == line.end()) {
+                errMsg = genErrMsg(lineCount, "expecting symbol, found newline");
+                return error;
+            }
+            ++tokenIt;
+            // PUBLIC expect exactly 1 argument
+            if (std::next(tokenIt) != line.end()) {
+                errMsg = genErrMsg(lineCount, "expecting newline, found " + *std::next(tokenIt));
+                return error;
+            }
+            // Symbol may still be undefined, so the definition is added at the end
+            symbolRefs.push_back({lineCount, CHECK_PUBLIC, -1, findSymbol(*tokenIt)});
+            continue;
+        }
+        if (op == "BEGIN") {
+            // Check if already in a section
+            if (section != NONE) {
+                errMsg = genErrMsg(lineCount, "cannot begin module inside a section");
+                return error;
+            }
+            // Check if already in a module
+            if (isModule) {
+                if (moduleEnded) {
+                    errMsg = genErrMsg(lineCount, "cannot have two modules in the same file");
+                } else {
+                    errMsg = genErrMsg(lineCount, "cannot BEGIN module inside another module");
+                }
+                return error;
+            }
+            isModule = true;
+            continue;
+        }
+        if (op == "END") {
+            // Check if in a module
+            if (!isModule) {
+                errMsg = genErrMsg(lineCount, "module not begun");
+                return error;
+            }
+            if (moduleEnded) {
+                errMsg = genErrMsg(lineCount, "cannot end module twice");
+                return error;
+            }
+            // Check if TEXT section was declared
+            if (!hadText) {
+                errMsg = genErrMsg(lineCount, "module must have a TEXT section");
+                return error;
+            }
+            section = NONE;
+            moduleEnded = true;
+            continue;
+        }
+
+        if (op == "SPACE") {
+            int nSpaces = 1;
+            // Check whether SPACE was given an argument or not
+            if (std::next(tokenIt) != line.end()) {
+                // Since an argument was given, check if it is valid
+                if (!std::regex_match(*std::next(tokenIt), natRegEx)) {
+                    errMsg = genErrMsg(lineCount, "invalid argument for SPACE directive: " + *std::next(tokenIt));
+                    return error;
+                }
+                ++tokenIt;
+                nSpaces = std::atoi((*tokenIt).c_str());
+            }
+            if (section == BSS) {
+                // Reserve memory space according to nSpaces, without emitting it
+                bssCount += nSpaces;
+            } else if (section == DATA) {
+                errMsg = genErrMsg(lineCount, "non-CONST operator/directive in DATA section");
+                return error;
+            } else if (section == TEXT) {
+                errMsg = genErrMsg(lineCount, op + " directive in TEXT section");
+                return error;
+            } else {
+                memCount += nSpaces;
+            }
+            // Check if there's any unexpected token after SPACE
+            if (std::next(tokenIt) != line.end()) {
+                errMsg = genErrMsg(lineCount, "found " + *std::next(tokenIt) + ", expected newline");
+                return error;
+            }
+            continue;
+        }
+
+        if (op == "CONST") {
+            // Check whether CONST was given an argument or not
+            if (std::next(tokenIt) == line.end()) {
+                errMsg = genErrMsg(lineCount, "expecting decimal or hexadecimal number, found newline");
+                return error;
+            }
+            ++tokenIt;
+
+            int constVal;
+            if (parseConst(lineCount, *tokenIt, &constVal)) {
+                return error;
+            }
+            memCount += 1;
+
+            // Mark label as zero value to check for zero division
+            if (constVal == 0 && labelSymbol != nullptr) {
+                labelSymbol->isZero = true;
+            }
+
+            if (section == DATA) {
+                machineCode.push_back(constVal);
+            } else if (section == BSS) {
+                errMsg = genErrMsg(lineCount, "non-SPACE operator/directive in BSS (uninitialized data) section");
+                return error;
+            } else if (section == TEXT) {
+                errMsg = genErrMsg(lineCount, op + " directive in TEXT section");
+                return error;
+            }
+
+            // CONST expects only a single value
+            if (std::next(tokenIt) != line.end()) {
+                errMsg = genErrMsg(lineCount, "found " + *std::next(tokenIt) + ", expected newline");
+                return error;
+            }
+            continue;
+        }
+
+        // Since instruction/directive was not handled above, check if it is defined
+        int opcode = isa::lookup(op);
+        if (opcode == isa::INVALID) {
+            errMsg = genErrMsg(lineCount, "instruction/directive " + op + " not defined");
+            return error;
+        }
+        memCount += isa::length(opcode);
+
+        if (section == BSS) {
+            errMsg = genErrMsg(lineCount, "non-SPACE operator/directive in BSS (uninitialized data) section");
+            return error;
+        } else if (section == DATA) {
+            errMsg = genErrMsg(lineCount, "non-CONST operator/directive in DATA section");
+            return error;
+        } else if (section != TEXT) {
+            continue;
+        }
+
+        // Add instruction opcode to code
+        machineCode.push_back(opcode);
+        textSize = machineCode.size() - 1 + isa::length(opcode);
+
+        // Handle arguments according to which instruction was given
+        switch (opcode) {
+        case isa::COPY:
+            // COPY takes 2 arguments, possibly comma-separated
+            if (std::next(tokenIt) == line.end()) {
+                errMsg = genErrMsg(lineCount, "expecting 2 operands, found none");
+                return error;
+            }
+            ++tokenIt;
+            emitArgument(lineCount, CHECK_DEFINED, &tokenIt, line.end());
+            if (error) return error;
+
+            // Check if second argument was given
+            if (std::next(tokenIt) == line.end()) {
+                errMsg = genErrMsg(lineCount, "expecting 2 operands, found 1");
+                return error;
+            }
+            ++tokenIt;
+            emitArgument(lineCount, CHECK_DEFINED, &tokenIt, line.end());
+            if (error) return error;
+
+            // Check if more than 2 arguments were given
+            if (std::next(tokenIt) != line.end()) {
+                errMsg = genErrMsg(lineCount, "expecting newline, found " + *std::next(tokenIt));
+                return error;
+            }
+            break;
+        case isa::STOP:
+            // STOP does not take any arguments
+            if (std::next(tokenIt) != line.end()) {
+                errMsg = genErrMsg(lineCount, "expecting newline, found " + *std::next(tokenIt));
+                return error;
+            }
+            break;
+        default:
+            // These instructions take a single defined symbol as argument
+            if (std::next(tokenIt) == line.end()) {
+                errMsg = genErrMsg(lineCount, "expecting 1 operand, found none");
+                return error;
+            }
+            ++tokenIt;
+
+            // Zero constants and data labels may be declared later on
+            int check;
+            if (opcode == isa::DIV) {
+                check = CHECK_DIV;
+            } else if (isa::isJump(opcode)) {
+                check = CHECK_JUMP;
+            } else {
+                check = CHECK_DEFINED;
+            }
+
+            emitArgument(lineCount, check, &tokenIt, line.end());
+            if (error) return error;
+
+            // Check if more than 1 argument was given
+            if (std::next(tokenIt) != line.end()) {
+                errMsg = genErrMsg(lineCount, "expecting newline, found " + *std::next(tokenIt));
+                return error;
+            }
+            break;
+        }
+    }
+
+    // Check if TEXT section was declared
+    if (!hadText) {
+        errMsg = "TEXT section not found";
+        error = 1;
+        return error;
+    }
+
+    // Place BSS after the code and patch every reference to it
+    for (auto& kvPair : symbolRecords) {
+        auto& symbol = kvPair.second;
+        if (symbol.isBss) {
+            symbol.addr += memCount;
+            for (auto index : symbol.fixups) {
+                machineCode[index] += symbol.addr;
+            }
+            symbol.fixups.clear();
+        }
+    }
+    bssSize = bssCount;
+
+    if (resolveDeferred()) {
+        return error;
+    }
+    return checkSize();
+}
+
+// Runs task on every chunk, one thread per chunk
+static void runChunks(std::vector<std::unique_ptr<Assembler>>& chunks, std::function<void(Assembler*)> task) {
+    std::vector<std::thread> workers;
+    for (auto& chunk : chunks) {
+        workers.push_back(std::thread(task, chunk.get()));
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+int Assembler::parallelPass(unsigned int nThreads) {
+    if (error != 0) {
+        return error;
+    }
+    if (nThreads == 0) {
+        nThreads = 1;
+    }
+    size_t chunkLines = (srcLines.size() + nThreads - 1) / nThreads;
+    if (chunkLines == 0) {
+        chunkLines = 1;
+    }
+
+    // Split lines into chunks, tracking the section and module state each chunk starts in
+    std::vector<std::unique_ptr<Assembler>> chunks;
+    int section = NONE;
+    bool hadText = false;
+    bool moduleEnded = false;
+    bool inModule = false;
+    auto lineIt = srcLines.begin();
+    while (lineIt != srcLines.end()) {
+        std::unique_ptr<Assembler> chunk(new Assembler(fileName, {}));
+        chunk->isChunk = true;
+        chunk->includedFiles = includedFiles;
+        chunk->startSection = section;
+        chunk->startHadText = hadText;
+        chunk->startModuleEnded = moduleEnded;
+        chunk->isModule = inModule;
+
+        auto chunkBegin = lineIt;
+        for (size_t i = 0; i < chunkLines && lineIt != srcLines.end(); ++i, ++lineIt) {
+            auto& line = std::get<1>(*lineIt);
+            if (line.front() == "SECTION") {
+                if (line.size() == 2) {
+                    if (line.back() == "TEXT") {
+                        section = TEXT;
+                        hadText = true;
+                    } else if (section != NONE && line.back() == "DATA") {
+                        section = DATA;
+                    } else if (section != NONE && line.back() == "BSS") {
+                        section = BSS;
+                    }
+                }
+                continue;
+            }
+            auto opIt = line.begin();
+            if (isSuffix(*opIt, ":")) {
+                ++opIt;
+            }
+            if (opIt == line.end()) {
+                continue;
+            }
+            if (*opIt == "BEGIN") {
+                inModule = true;
+            } else if (*opIt == "END") {
+                section = NONE;
+                moduleEnded = true;
+            }
+        }
+        chunk->srcLines.splice(chunk->srcLines.end(), srcLines, chunkBegin, lineIt);
+        chunks.push_back(std::move(chunk));
+    }
+    auto restoreLines = [&]() {
+        for (auto& chunk : chunks) {
+            srcLines.splice(srcLines.end(), chunk->srcLines);
+        }
+    };
+
+    // Compute each chunk's size and local labels in parallel
+    runChunks(chunks, [](Assembler* chunk) {
+        chunk->firstPass();
+    });
+
+    // Merge symbol tables, shifting local labels by the sizes of the chunks before them.
+    // The first error in source order wins, including cross-chunk redefinitions. Chunks
+    // come in source order but included lines are numbered past the main file's, so line
+    // numbers are only compared within a chunk
+    int firstErrLine = INT_MAX;
+    Assembler* firstErrChunk = nullptr;
+    std::string firstErrMsg;
+    int memOffset = 0;
+    // BSS labels go after the code of every chunk
+    int bssOffset = 0;
+    for (auto& chunk : chunks) {
+        bssOffset += chunk->memSize;
+    }
+    for (auto& chunk : chunks) {
+        if (chunk->error && (!firstErrChunk || (firstErrChunk == chunk.get() && chunk->errLine < firstErrLine))) {
+            firstErrChunk = chunk.get();
+            firstErrLine = chunk->errLine;
+            firstErrMsg = chunk->errMsg;
+        }
+        for (auto kvPair : chunk->symbolsMap) {
+            auto label = kvPair.first;
+            if (symbolsMap.count(label) > 0) {
+                int lineCount = chunk->symbolLines[label];
+                if (!firstErrChunk || (firstErrChunk == chunk.get() && lineCount < firstErrLine)) {
+                    firstErrChunk = chunk.get();
+                    firstErrLine = lineCount;
+                    firstErrMsg = genErrMsg(lineCount, "symbol redefinition");
+                }
+                continue;
+            }
+            if (chunk->externSymbols.count(label) > 0) {
+                symbolsMap[label] = 0;
+            } else if (chunk->bssSymbols.count(label) > 0) {
+                symbolsMap[label] = kvPair.second + bssOffset;
+            } else {
+                symbolsMap[label] = kvPair.second + memOffset;
+            }
+        }
+        externSymbols.insert(chunk->externSymbols.begin(), chunk->externSymbols.end());
+        zeroList.insert(chunk->zeroList.begin(), chunk->zeroList.end());
+        invalidJumpList.insert(chunk->invalidJumpList.begin(), chunk->invalidJumpList.end());
+        isModule = isModule || chunk->isModule;
+        memOffset += chunk->memSize;
+        bssOffset += chunk->bssSize;
+        bssSize += chunk->bssSize;
+    }
+    if (firstErrChunk) {
+        restoreLines();
+        errMsg = firstErrMsg;
+        error = 1;
+        return error;
+    }
+    // Check if TEXT section was declared
+    if (!hadText) {
+        restoreLines();
+        errMsg = "TEXT section not found";
+        error = 1;
+        return error;
+    }
+
+    // Emit each chunk's code in parallel against the global symbol table
+    runChunks(chunks, [this](Assembler* chunk) {
+        chunk->isModule = isModule;
+        chunk->symbolsMap = symbolsMap;
+        chunk->externSymbols = externSymbols;
+        chunk->zeroList = zeroList;
+        chunk->invalidJumpList = invalidJumpList;
+        chunk->secondPass();
+    });
+    restoreLines();
+
+    // Concatenate chunk outputs, shifting RELATIVE and USE entries by the code emitted before them
+    int codeOffset = 0;
+    for (auto& chunk : chunks) {
+        if (chunk->error) {
+            errMsg = chunk->errMsg;
+            error = 1;
+            return error;
+        }
+        for (auto rel : chunk->relative) {
+            relative.push_back(rel + codeOffset);
+        }
+        for (auto use : chunk->useTable) {
+            useTable.push_back(std::make_tuple(std::get<0>(use), std::get<1>(use) + codeOffset));
+        }
+        definitionTable.insert(definitionTable.end(), chunk->definitionTable.begin(), chunk->definitionTable.end());
+        if (chunk->textSize > 0) {
+            textSize = codeOffset + chunk->textSize;
+        }
+        codeOffset += chunk->machineCode.size();
+        machineCode.insert(machineCode.end(), chunk->machineCode.begin(), chunk->machineCode.end());
+    }
+
+    return checkSize();
+}
+
+ObjectModule Assembler::getObject() {
+    ObjectModule object;
+    object.name = fileName;
+    object.isModule = isModule;
+    object.useTable = useTable;
+    object.definitionTable = definitionTable;
+    object.relative = relative;
+    object.code.assign(machineCode.begin(), machineCode.end());
+    if (textSize > 0) {
+        object.text.push_back(std::make_pair(0u, (unsigned int)textSize));
+    }
+    object.bss = bssSize;
+    return object;
 }
 
 std::string Assembler::getErrorMessage() {
     return errMsg;
 }
 
+void Assembler::setIncludedFiles(const std::vector<std::string>& includedFiles) {
+    this->includedFiles = includedFiles;
+}
+
 int Assembler::getError() {
     return error;
 }
 
 std::string Assembler::genErrMsg(int lineCount, std::string message) {
     error = 1;
-    return "line " + std::to_string(lineCount) + ": " + message;
+    errLine = lineCount;
+    return describeLine(lineCount, includedFiles) + ": " + message;
 }
 
 void Assembler::handleArgument(int lineCount, std::list<std::string>::iterator* tokenItPtr, std::list<std::string>::iterator lineEnd, int* memCountPtr) {
@@ -675,3 +1215,138 @@ void Assembler::handleArgument(int lineCount, std::list<std::string>::iterator*
     }
     ++*memCountPtr;
 }
+
+std::unordered_map<std::string, Assembler::Symbol>::value_type* Assembler::findSymbol(const std::string& name) {
+    auto symbolIt = symbolRecords.find(name);
+    if (symbolIt == symbolRecords.end()) {
+        Symbol symbol = {0, false, false, false, false, false, {}};
+        symbolIt = symbolRecords.insert(std::make_pair(name, symbol)).first;
+    }
+    return &*symbolIt;
+}
+
+void Assembler::emitArgument(int lineCount, int check, std::list<std::string>::iterator* tokenItPtr, std::list<std::string>::iterator lineEnd) {
+    auto operand = **tokenItPtr;
+
+    // Check if operator is COPY (takes two arguments, need to handle comma)
+    bool isCopy = false;
+    if (*std::prev(*tokenItPtr) == "COPY") {
+        isCopy = true;
+        // Remove comma if needed
+        if (isSuffix(operand, ",")) {
+            operand.pop_back();
+        }
+    }
+
+    int memOperand = 0;
+
+    // Handle LABEL + N case
+    if (std::next(*tokenItPtr) != lineEnd && *std::next(*tokenItPtr) == "+") {
+        ++*tokenItPtr;
+        // Check if there is a token after +
+        if (std::next(*tokenItPtr) == lineEnd) {
+            errMsg = genErrMsg(lineCount, "expecting decimal number, found newline");
+            return;
+        }
+        ++*tokenItPtr;
+        auto N = **tokenItPtr;
+        // Handle comma if necessary
+        if (isCopy && isSuffix(N, ",")) {
+            N.pop_back();
+        }
+        // Check if token after + is a valid number
+        if (!std::regex_match(N, natRegEx)) {
+            errMsg = genErrMsg(lineCount, "expecting decimal number, found " + N);
+            return;
+        }
+        memOperand += std::atoi(N.c_str());
+    } else if (!isCopy && std::next(*tokenItPtr) != lineEnd) {
+        errMsg = genErrMsg(lineCount, "expecting + or newline, found " + *std::next(*tokenItPtr));
+        return;
+    }
+
+    // Known symbols are resolved right away, others wait in the symbol's fixup chain
+    auto symbol = findSymbol(operand);
+    symbolRefs.push_back({lineCount, check, (int)machineCode.size(), symbol});
+    if (symbol->second.defined && !symbol->second.isBss) {
+        machineCode.push_back(memOperand + symbol->second.addr);
+    } else {
+        machineCode.push_back(memOperand);
+        symbol->second.fixups.push_back(machineCode.size() - 1);
+    }
+}
+
+// Parses a decimal or hexadecimal CONST argument, which must fit in a word
+int Assembler::parseConst(int lineCount, std::string token, int* value) {
+    long long parsed;
+    if (std::regex_match(token, intRegEx)) {
+        parsed = std::strtoll(token.c_str(), nullptr, 10);
+    } else if (std::regex_match(token, hexRegEx)) {
+        parsed = std::strtoll(token.c_str(), nullptr, 16);
+    } else {
+        errMsg = genErrMsg(lineCount, "invalid immediate " + token);
+        return error;
+    }
+    if (parsed < isa::WORD_MIN || parsed > isa::WORD_MAX) {
+        errMsg = genErrMsg(lineCount, "constant " + token + " does not fit in a " + std::to_string(WORD_BITS) + "-bit word");
+        return error;
+    }
+    *value = (isa::Word)parsed;
+    return 0;
+}
+
+// Addresses past the limit would wrap around in the word they are stored in
+int Assembler::checkSize() {
+    unsigned long size = machineCode.size() + bssSize;
+    if (size > isa::ADDRESS_LIMIT) {
+        errMsg = "program takes " + std::to_string(size) + " words, more than " + std::to_string(isa::ADDRESS_LIMIT) +
+                 " can be addressed with " + std::to_string(WORD_BITS) + "-bit words";
+        error = 1;
+        return error;
+    }
+    return 0;
+}
+
+int Assembler::resolveDeferred() {
+    // Run checks that needed the whole symbol table, in source order
+    for (auto ref : symbolRefs) {
+        auto& name = ref.symbol->first;
+        auto& symbol = ref.symbol->second;
+        if (ref.check == CHECK_PUBLIC) {
+            // Check if symbol is extern
+            if (symbol.isExtern) {
+                errMsg = genErrMsg(ref.lineCount, "cannot make extern symbol public");
+                return error;
+            }
+            // Check if symbol was defined
+            if (!symbol.defined) {
+                errMsg = genErrMsg(ref.lineCount, "unknown symbol " + name);
+                return error;
+            }
+            definitionTable.push_back(std::make_tuple(name, symbol.addr));
+            continue;
+        }
+
+        if (ref.check == CHECK_DIV && symbol.isZero) {
+            errMsg = genErrMsg(ref.lineCount, "division by zero");
+            return error;
+        }
+        if (ref.check == CHECK_JUMP && symbol.isData) {
+            errMsg = genErrMsg(ref.lineCount, "jump to label " + name + " in invalid section");
+            return error;
+        }
+        if (!symbol.defined) {
+            errMsg = genErrMsg(ref.lineCount, "unknown symbol " + name);
+            return error;
+        }
+
+        // Extern operands go to the use table, all others are relocated
+        if (symbol.isExtern) {
+            useTable.push_back(std::make_tuple(name, ref.addr));
+        } else {
+            relative.push_back(ref.addr);
+        }
+    }
+
+    return 0;
+}
@@ -2,6 +2,7 @@
 #include <string>
 #include <fstream>
 #include <list>
+#include <thread>
 #include <utils.hpp>
 #include <preprocessor.hpp>
 #include <assembler.hpp>
@@ -11,11 +12,31 @@ using namespace std;
 int main(int argc, char** argv) { 
     if (argc < 2) {
         cout << "Missing arguments! Expecting 1:" << endl
-        << "Usage: montador <file-to-assemble-without-extension>" << endl;
+        << "Usage: montador [--single-pass | -j <threads>] [--binary] [--include-cache <dir>] <file-to-assemble-without-extension>" << endl;
         return -1;
     }
 
-    string fileName = string(argv[1]); 
+    string fileName;
+    bool singlePass = false;
+    bool binary = false;
+    unsigned int nThreads = 0;
+    for (int i = 1; i < argc; ++i) {
+        string arg = string(argv[i]);
+        if (arg == "--single-pass") {
+            singlePass = true;
+        } else if (arg == "--binary") {
+            binary = true;
+        } else if (arg == "--include-cache" && i + 1 < argc) {
+            PreProcessor::setIncludeCache(argv[++i]);
+        } else if (arg == "-j" && i + 1 < argc) {
+            nThreads = atoi(argv[++i]);
+            if (nThreads == 0) {
+                nThreads = std::thread::hardware_concurrency();
+            }
+        } else {
+            fileName = arg;
+        }
+    }
 
     PreProcessor pp(fileName);
     if(pp.getError()) {
@@ -28,20 +49,35 @@ int main(int argc, char** argv) {
     }
     pp.writeOutput();
     Assembler assembler(fileName, pp.getOutput());
+    assembler.setIncludedFiles(pp.getIncludedFiles());
 
-    err = assembler.firstPass();
-    if (err) {
-        cout << "first pass error: " + assembler.getErrorMessage() << std::endl;
-        return -1;
-    }
+    if (nThreads > 0) {
+        err = assembler.parallelPass(nThreads);
+        if (err) {
+            cout << "parallel pass error: " + assembler.getErrorMessage() << std::endl;
+            return -1;
+        }
+    } else if (singlePass) {
+        err = assembler.singlePass();
+        if (err) {
+            cout << "single pass error: " + assembler.getErrorMessage() << std::endl;
+            return -1;
+        }
+    } else {
+        err = assembler.firstPass();
+        if (err) {
+            cout << "first pass error: " + assembler.getErrorMessage() << std::endl;
+            return -1;
+        }
 
-    err = assembler.secondPass();
-    if (err) {
-        cout << "second pass error: " + assembler.getErrorMessage() << std::endl;
-        return -1;
+        err = assembler.secondPass();
+        if (err) {
+            cout << "second pass error: " + assembler.getErrorMessage() << std::endl;
+            return -1;
+        }
     }
 
-    err = assembler.writeOutput();
+    err = assembler.writeOutput(binary);
     if (err) {
         cout << "write error: " + assembler.getErrorMessage() << std::endl;
         return -1;
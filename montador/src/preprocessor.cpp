@@ -1,5 +1,9 @@
 #include <preprocessor.hpp>
 
+#include <cstdio>
+#include <mutex>
+#include <unistd.h>
+
 PreProcessor::PreProcessor(std::string fileName) {
     this->fileName = fileName;
     std::string asmName = fileName + ".asm";  // input file name
@@ -9,17 +13,31 @@ PreProcessor::PreProcessor(std::string fileName) {
         return;
     }
 
-    // Read all lines from file
-    std::ifstream srcFile;
-    srcFile.open(asmName);
-    std::string line;
+    // Map file and index its lines without copying them
+    reader.reset(new FileReader(asmName));
+    if (reader->getError()) {
+        std::cout << "File " + asmName + " could not be read\n";
+        error = -1;
+        return;
+    }
+    indexLines();
+}
+
+PreProcessor::PreProcessor(std::string fileName, std::string source) {
+    // Source given in memory; fileName only names the outputs
+    this->fileName = fileName;
+    reader.reset(new FileReader(fileName + ".asm", source));
+    indexLines();
+}
+
+void PreProcessor::indexLines() {
+    TextView line;
     unsigned int lineCount = 1;
-    while (getline(srcFile, line)) {
+    while (reader->nextLine(&line)) {
         auto lineTuple = std::make_tuple(lineCount, line);
         srcLines.push_back(lineTuple);
         ++lineCount;
     }
-    srcFile.close();
 }
 
 PreProcessor::~PreProcessor() {}
@@ -29,8 +47,8 @@ int PreProcessor::printSource() {
         return error;
     }
     for (auto lineTuple : srcLines) {
-        printf("%3d:%s\n", std::get<0>(lineTuple),
-               std::get<1>(lineTuple).c_str());
+        auto line = std::get<1>(lineTuple);
+        printf("%3d:%.*s\n", std::get<0>(lineTuple), (int)line.size, line.data);
     }
     return 0;
 }
@@ -78,83 +96,277 @@ std::list<std::tuple<int, std::list<std::string>>> PreProcessor::getOutput() {
     return outLines;
 }
 
+// "INCLUDE" lines keep the file name as written, since other tokens are upper-cased;
+// a missing or unquoted name is left empty
+static std::list<std::string> tokenizeLine(TextView raw) {
+    auto line = stripComment(raw);
+    // If line is empty after removing spaces, remove it in pre-processing
+    if (std::all_of(line.begin(), line.end(), isspace)) {
+        return {};
+    }
+    // Split line in tokens
+    auto tokensInLine = tokenize(line);
+    if (!tokensInLine.empty() && tokensInLine.front() == "INCLUDE") {
+        std::string text = line.str();
+        auto open = text.find('"');
+        auto close = open == std::string::npos ? open : text.find('"', open + 1);
+        std::string name;
+        if (close != std::string::npos) {
+            name = text.substr(open + 1, close - open - 1);
+        }
+        tokensInLine = {"INCLUDE", name};
+    }
+    return tokensInLine;
+}
+
+static std::string directoryOf(std::string path) {
+    auto slash = path.rfind('/');
+    return slash == std::string::npos ? "" : path.substr(0, slash + 1);
+}
+
+// Tokenized include files, shared by every PreProcessor of a run. Lines are kept as
+// tokenized, empty ones included, so IF skips the same lines as in a main file
+typedef std::vector<std::tuple<int, std::list<std::string>>> IncludeLines;
+static std::mutex includeMutex;
+static std::map<std::string, std::shared_ptr<const IncludeLines>> includeCache;
+static std::string includeCacheDir;
+
+void PreProcessor::setIncludeCache(std::string dir) {
+    std::lock_guard<std::mutex> lock(includeMutex);
+    includeCacheDir = dir;
+}
+
+// Cache files are "SBINC 1", then for each line its number and token count followed
+// by one token per line
+static std::string cachePath(std::string dir, uint64_t hash) {
+    char name[17];
+    snprintf(name, sizeof(name), "%016llx", (unsigned long long)hash);
+    return dir + "/" + name + ".inc";
+}
+
+static bool loadTokens(std::string path, IncludeLines* lines) {
+    std::ifstream in(path);
+    std::string magic;
+    if (!std::getline(in, magic) || magic != "SBINC 1") {
+        return false;
+    }
+    int lineCount;
+    size_t count;
+    while (in >> lineCount >> count) {
+        in.ignore(1);
+        std::list<std::string> tokens;
+        std::string token;
+        for (size_t i = 0; i < count; ++i) {
+            if (!std::getline(in, token)) {
+                return false;
+            }
+            tokens.push_back(token);
+        }
+        lines->push_back(std::make_tuple(lineCount, tokens));
+    }
+    return in.eof();
+}
+
+// Written under a temporary name and renamed, so concurrent runs never read half a file
+static void storeTokens(std::string path, const IncludeLines& lines) {
+    std::string tempName = path + "." + std::to_string(getpid());
+    std::ofstream out(tempName);
+    out << "SBINC 1\n";
+    for (auto& line : lines) {
+        out << std::get<0>(line) << " " << std::get<1>(line).size() << "\n";
+        for (auto& token : std::get<1>(line)) {
+            out << token << "\n";
+        }
+    }
+    out.close();
+    if (out.fail() || rename(tempName.c_str(), path.c_str()) != 0) {
+        unlink(tempName.c_str());
+    }
+}
+
+// Tokenizes an include file once per run, or once per contents with a cache directory
+static std::shared_ptr<const IncludeLines> readInclude(std::string path) {
+    std::string dir;
+    {
+        std::lock_guard<std::mutex> lock(includeMutex);
+        auto it = includeCache.find(path);
+        if (it != includeCache.end()) {
+            return it->second;
+        }
+        dir = includeCacheDir;
+    }
+    if (!fileExists(path)) {
+        return nullptr;
+    }
+    FileReader file(path);
+    if (file.getError()) {
+        return nullptr;
+    }
+    auto lines = std::make_shared<IncludeLines>();
+    std::string cacheName = dir.empty() ? "" : cachePath(dir, hashContents(file.contents()));
+    if (cacheName.empty() || !loadTokens(cacheName, lines.get())) {
+        lines->clear();
+        TextView line;
+        int lineCount = 1;
+        while (file.nextLine(&line)) {
+            lines->push_back(std::make_tuple(lineCount++, tokenizeLine(line)));
+        }
+        if (!cacheName.empty()) {
+            storeTokens(cacheName, *lines);
+        }
+    }
+    std::lock_guard<std::mutex> lock(includeMutex);
+    return includeCache.emplace(path, lines).first->second;
+}
+
+std::string describeLine(int lineCount, const std::vector<std::string>& includedFiles) {
+    size_t index = lineCount >> INCLUDE_LINE_BITS;
+    if (index > 0 && index <= includedFiles.size()) {
+        return includedFiles[index - 1] + " line " + std::to_string(lineCount & ((1 << INCLUDE_LINE_BITS) - 1));
+    }
+    return "line " + std::to_string(lineCount);
+}
+
+int PreProcessor::include(int lineCount, std::string name, std::string baseDir) {
+    if (name.empty()) {
+        std::cout << describeLine(lineCount, includedFiles) << ": INCLUDE expects a file name in double quotes\n";
+        error = 1;
+        return error;
+    }
+    // Names are relative to the including file
+    std::string path = name[0] == '/' ? name : baseDir + name;
+    if (std::find(includeStack.begin(), includeStack.end(), path) != includeStack.end()) {
+        std::cout << describeLine(lineCount, includedFiles) << ": " + path + " includes itself\n";
+        error = 1;
+        return error;
+    }
+    auto lines = readInclude(path);
+    if (!lines) {
+        std::cout << describeLine(lineCount, includedFiles) << ": included file " + path + " does not exist\n";
+        error = 1;
+        return error;
+    }
+    if (includeIndex.count(path) == 0) {
+        if (includedFiles.size() + 1 >= (1u << (31 - INCLUDE_LINE_BITS))) {
+            std::cout << describeLine(lineCount, includedFiles) << ": too many included files\n";
+            error = 1;
+            return error;
+        }
+        includedFiles.push_back(path);
+        includeIndex[path] = includedFiles.size();
+    }
+
+    int base = includeIndex[path] << INCLUDE_LINE_BITS;
+    std::string dir = directoryOf(path);
+    includeStack.push_back(path);
+    for (auto lineIt = lines->begin(); lineIt != lines->end(); ++lineIt) {
+        bool skipNext = false;
+        if (processLine(base + std::get<0>(*lineIt), std::get<1>(*lineIt), dir, &skipNext)) {
+            return error;
+        }
+        if (skipNext && std::next(lineIt) != lines->end()) {
+            ++lineIt;
+        }
+    }
+    includeStack.pop_back();
+    return 0;
+}
+
+const std::vector<std::string>& PreProcessor::getIncludedFiles() {
+    return includedFiles;
+}
+
 int PreProcessor::preProcess() {
     if (error != 0) {
         return error;
     }
 
-    std::map<std::string, int> equMap;
+    std::string baseDir = directoryOf(fileName);
+    includeStack = {fileName + ".asm"};
     for (auto lineTupleIt = srcLines.begin(); lineTupleIt != srcLines.end();
          ++lineTupleIt) {
-        auto lineTuple = *lineTupleIt;
-        int lineCount = std::get<0>(lineTuple);
-        std::string line = std::get<1>(lineTuple);
-
-        line = line.substr(0, line.find(";", 0));
-
-        // If line is empty after removing spaces, remove it in pre-processing
-        if (!std::all_of(line.begin(), line.end(), isspace)) {
-            // Split line in tokens
-            auto tokensInLine = tokenize(line);
-            // If no token is found, continue on to the next line
-            if (tokensInLine.empty()) continue;
-            
-            auto firstToken = tokensInLine.front();
-
-            // Check if first token is a label
-            if (isSuffix(firstToken, ":")) {
-                firstToken.pop_back();
-                
-                // Check if any label used is an already set EQU label
-                if (equMap.count(firstToken) > 0) {
-                    error = 1;
-                    return error;
-                }
-                
-                // Check if label is an EQU label
-                auto secondTokenIt = std::next(tokensInLine.begin());
-                if (secondTokenIt != tokensInLine.end()){
-                    auto secondToken = *std::next(tokensInLine.begin());
-                    if (secondToken == "EQU") {
-                        auto equLabel = firstToken;
-                        auto equValStr = *std::next(tokensInLine.begin(), 2);
-                        auto equVal = atoi(equValStr.c_str());
-                        auto equTuple = std::make_tuple(equLabel, equVal);
-                        equMap[equLabel] = equVal;
-                        continue;
-                    }
-                }
-            }
+        bool skipNext = false;
+        if (processLine(std::get<0>(*lineTupleIt), tokenizeLine(std::get<1>(*lineTupleIt)), baseDir, &skipNext)) {
+            return error;
+        }
+        if (skipNext && std::next(lineTupleIt) != srcLines.end()) {
+            ++lineTupleIt;
+        }
+    }
+    return 0;
+}
 
-            // Check if any label used is an already set EQU label
-            for (auto tokenIt = tokensInLine.begin(); tokenIt != tokensInLine.end(); ++tokenIt) {
-                if (equMap.count(*tokenIt) > 0) {
-                    *tokenIt = std::to_string(equMap[*tokenIt]);
-                }
-            }
+// Expands one tokenized line; a false IF sets skipNext to drop the line after it
+int PreProcessor::processLine(int lineCount, std::list<std::string> tokensInLine, std::string baseDir, bool* skipNext) {
+    // If no token is found, continue on to the next line
+    if (tokensInLine.empty()) return 0;
+
+    auto firstToken = tokensInLine.front();
+    if (firstToken == "INCLUDE") {
+        return include(lineCount, tokensInLine.back(), baseDir);
+    }
+
+    // Check if first token is a label
+    if (isSuffix(firstToken, ":")) {
+        firstToken.pop_back();
+
+        // Check if label is an EQU label
+        auto secondTokenIt = std::next(tokensInLine.begin());
+        bool isEqu = secondTokenIt != tokensInLine.end() && *secondTokenIt == "EQU";
+        if (isEqu && tokensInLine.size() < 3) {
+            std::cout << describeLine(lineCount, includedFiles) << ": EQU " + firstToken + " has no value\n";
+            error = 1;
+            return error;
+        }
+        int equVal = isEqu ? atoi(std::next(secondTokenIt)->c_str()) : 0;
 
-            // Handle IF labels
-            for (auto tokenIt = tokensInLine.begin(); tokenIt != tokensInLine.end(); ++tokenIt) {
-                if (*tokenIt == "IF") {
-                    auto ifValStr = *std::next(tokenIt);
-                    auto ifVal = atoi(ifValStr.c_str());
-                    while(tokensInLine.back() != "IF") {
-                        tokensInLine.pop_back();
-                    }
-                    tokensInLine.pop_back();
-                    if (ifVal == 0) {
-                        ++lineTupleIt;
-                    }
-                    break;
-                }
+        // Labels may not reuse an EQU label; an EQU repeated with the same value (a header
+        // included twice) is accepted
+        auto equIt = equMap.find(firstToken);
+        if (equIt != equMap.end()) {
+            if (isEqu && equIt->second == equVal) {
+                return 0;
             }
+            std::cout << describeLine(lineCount, includedFiles) << ": " + firstToken
+                      << (isEqu ? " redefined with a different value (was " + std::to_string(equIt->second) + ")"
+                                : " is already an EQU label") << "\n";
+            error = 1;
+            return error;
+        }
+
+        if (isEqu) {
+            equMap[firstToken] = equVal;
+            return 0;
+        }
+    }
+
+    // Check if any label used is an already set EQU label
+    for (auto tokenIt = tokensInLine.begin(); tokenIt != tokensInLine.end(); ++tokenIt) {
+        if (equMap.count(*tokenIt) > 0) {
+            *tokenIt = std::to_string(equMap[*tokenIt]);
+        }
+    }
 
-            if(!tokensInLine.empty()) {
-                auto outLine = std::make_tuple(lineCount, tokensInLine);
-                outLines.push_back(outLine);
+    // Handle IF labels
+    for (auto tokenIt = tokensInLine.begin(); tokenIt != tokensInLine.end(); ++tokenIt) {
+        if (*tokenIt == "IF") {
+            auto ifValStr = *std::next(tokenIt);
+            auto ifVal = atoi(ifValStr.c_str());
+            while(tokensInLine.back() != "IF") {
+                tokensInLine.pop_back();
+            }
+            tokensInLine.pop_back();
+            if (ifVal == 0) {
+                *skipNext = true;
             }
+            break;
         }
     }
+
+    if(!tokensInLine.empty()) {
+        auto outLine = std::make_tuple(lineCount, tokensInLine);
+        outLines.push_back(outLine);
+    }
     return 0;
 }
 
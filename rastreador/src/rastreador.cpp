@@ -0,0 +1,146 @@
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <handlers.hpp>
+#include <isa.hpp>
+#include <trace.hpp>
+
+// Fusion patterns are listed in handler order
+static const Handlers::FusionPattern* fusedPattern(int handler) {
+    if (handler < Handlers::FIRST_FUSED || handler >= Handlers::HANDLER_COUNT) {
+        return nullptr;
+    }
+    return &Handlers::fusionPatterns[handler - Handlers::FIRST_FUSED];
+}
+
+static std::string handlerName(int handler) {
+    if (isa::isOpcode(handler)) {
+        return isa::instructions[handler].mnemonic;
+    }
+    auto pattern = fusedPattern(handler);
+    return pattern ? pattern->name : "?";
+}
+
+// Parses "a" or "a-b" into an inclusive range
+static bool parseRange(std::string arg, unsigned long* first, unsigned long* last) {
+    char* end;
+    *first = std::strtoul(arg.c_str(), &end, 10);
+    *last = *first;
+    if (*end == '-') {
+        *last = std::strtoul(end + 1, &end, 10);
+    }
+    return *end == '\0' && *first <= *last;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cout << "Missing arguments! Expecting 1:" << std::endl
+        << "Usage: rastreador [--pc <addr>[-<addr>]] [--addr <addr>[-<addr>]] [--op <mnemonic>] [--io] [--last <n>] <trace-file>" << std::endl;
+        return -1;
+    }
+
+    std::string fileName;
+    unsigned long pcFirst = 0, pcLast = UINT32_MAX;
+    unsigned long addrFirst = 0, addrLast = UINT32_MAX;
+    bool addrFilter = false;
+    int opcode = isa::INVALID;
+    bool ioOnly = false;
+    unsigned long last = 0;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = std::string(argv[i]);
+        if (arg == "--pc" && i + 1 < argc) {
+            if (!parseRange(argv[++i], &pcFirst, &pcLast)) {
+                std::cout << "invalid address range " << argv[i] << std::endl;
+                return -1;
+            }
+        } else if (arg == "--addr" && i + 1 < argc) {
+            if (!parseRange(argv[++i], &addrFirst, &addrLast)) {
+                std::cout << "invalid address range " << argv[i] << std::endl;
+                return -1;
+            }
+            addrFilter = true;
+        } else if (arg == "--op" && i + 1 < argc) {
+            opcode = isa::lookup(argv[++i]);
+            if (opcode == isa::INVALID) {
+                std::cout << "unknown instruction " << argv[i] << std::endl;
+                return -1;
+            }
+        } else if (arg == "--io") {
+            ioOnly = true;
+        } else if (arg == "--last" && i + 1 < argc) {
+            last = std::strtoul(argv[++i], nullptr, 10);
+        } else {
+            fileName = arg;
+        }
+    }
+
+    TraceHeader header;
+    std::vector<TraceRecord> records;
+    std::string errMsg;
+    if (readTrace(fileName, &header, &records, &errMsg)) {
+        std::cout << errMsg << std::endl;
+        return -1;
+    }
+
+    // Records are numbered by the first instruction they stand for, counted from zero
+    uint64_t kept = 0;
+    for (const TraceRecord& record : records) {
+        kept += record.instructions;
+    }
+    uint64_t seq = header.instructions - kept;
+    // Accumulator starts at zero, so it can be replayed exactly when no record was lost
+    bool complete = records.size() == header.count;
+    std::cout << "# " << kept << " of " << header.instructions << " instructions in "
+              << records.size() << " records" << (complete ? "" : " (older ones were overwritten)") << std::endl;
+
+    size_t from = last > 0 && last < records.size() ? records.size() - last : 0;
+    uint32_t acc = 0;
+    for (size_t i = 0; i < records.size(); ++i) {
+        const TraceRecord& record = records[i];
+        acc += (uint32_t)record.accDelta;
+        uint64_t first = seq;
+        seq += record.instructions;
+        if (i < from || record.pc < pcFirst || record.pc > pcLast) continue;
+        if (ioOnly && record.event != TRACE_INPUT && record.event != TRACE_OUTPUT) continue;
+        if (addrFilter && (record.event == TRACE_NONE || record.event == TRACE_ERROR ||
+                           record.addr < addrFirst || record.addr > addrLast)) continue;
+        // Fused records match any of the instructions they stand for
+        if (opcode != isa::INVALID && record.handler != opcode) {
+            auto pattern = fusedPattern(record.handler);
+            bool matches = false;
+            for (int j = 0; pattern && j < pattern->size; ++j) {
+                matches = matches || pattern->opcodes[j] == opcode;
+            }
+            if (!matches) continue;
+        }
+
+        std::cout << first << " " << record.pc << " ";
+        if (record.event == TRACE_ERROR) {
+            std::cout << "error" << std::endl;
+            continue;
+        }
+        std::cout << handlerName(record.handler);
+        if (complete) {
+            std::cout << " acc=" << (int32_t)acc;
+        } else if (record.accDelta != 0) {
+            std::cout << " acc+=" << record.accDelta;
+        }
+        switch (record.event) {
+        case TRACE_WRITE:
+            std::cout << " [" << record.addr << "]=" << record.value;
+            break;
+        case TRACE_INPUT:
+            std::cout << " input [" << record.addr << "]=" << record.value;
+            break;
+        case TRACE_OUTPUT:
+            std::cout << " output [" << record.addr << "]=" << record.value;
+            break;
+        }
+        std::cout << std::endl;
+    }
+
+    return 0;
+}
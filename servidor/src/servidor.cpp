@@ -0,0 +1,397 @@
+#include <condition_variable>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include <scheduler.hpp>
+
+// Request and response lines of the protocol:
+//   RUN <image> <max-instructions> <n> <input 1> ... <input n>
+//   OK <instructions> <n> <output 1> ... <output n>
+//   ERROR <status> <instructions> <message>
+//   STATS
+//   OK images <resident> hits <count> misses <count>
+// Statuses are the emulador's exit statuses: 2, 3 and 4 for the limits, 255 for other
+// simulation errors, and 1 for requests that could not be run at all
+
+static const int LIMIT_STATUS[] = {0, 2, 3, 4};
+
+// Parsed, fused and verified images keyed by the hash of their contents, so paths with the
+// same contents share one. Paths remember their hash until the file changes on disk. Images
+// are built from the bytes that were hashed, never mapped, so a file rewritten or truncated
+// later cannot change or break an image that is still resident
+class ImageCache {
+    private:
+        struct Resident {
+            std::shared_ptr<const Image> image;
+            unsigned long lastUse;
+        };
+        struct PathState {
+            dev_t dev;
+            ino_t ino;
+            off_t size;
+            struct timespec mtime;
+            uint64_t hash;
+        };
+        std::mutex mutex;
+        std::map<uint64_t, Resident> images;
+        std::map<std::string, PathState> paths;
+        size_t capacity;
+        unsigned long clock = 0;
+        unsigned long hits = 0;
+        unsigned long misses = 0;
+
+        static bool sameFile(const PathState& state, const struct stat& st) {
+            return state.dev == st.st_dev && state.ino == st.st_ino && state.size == st.st_size &&
+                   state.mtime.tv_sec == st.st_mtim.tv_sec && state.mtime.tv_nsec == st.st_mtim.tv_nsec;
+        }
+
+        std::shared_ptr<const Image> use(std::map<uint64_t, Resident>::iterator it) {
+            it->second.lastUse = ++clock;
+            ++hits;
+            return it->second.image;
+        }
+    public:
+        ImageCache(size_t capacity) : capacity(capacity) {}
+
+        std::shared_ptr<const Image> get(std::string path, std::string* errMsg) {
+            struct stat st;
+            if (stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+                *errMsg = "image " + path + " does not exist";
+                return nullptr;
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                auto state = paths.find(path);
+                if (state != paths.end() && sameFile(state->second, st)) {
+                    auto it = images.find(state->second.hash);
+                    if (it != images.end()) {
+                        return use(it);
+                    }
+                }
+            }
+
+            // Reading and loading happen outside the lock, so hot images are not held up by a cold one
+            FileReader file(path);
+            if (file.getError()) {
+                *errMsg = "image " + path + " could not be read";
+                return nullptr;
+            }
+            uint64_t hash = hashContents(file.contents());
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                paths[path] = {st.st_dev, st.st_ino, st.st_size, st.st_mtim, hash};
+                auto it = images.find(hash);
+                if (it != images.end()) {
+                    return use(it);
+                }
+            }
+            std::vector<int> words;
+            unsigned int entry, bss;
+            if (parseExecutable(file.contents(), &words, &entry, &bss, errMsg)) {
+                *errMsg += " in image " + path;
+                return nullptr;
+            }
+            words.resize(words.size() + bss, 0);
+            auto image = std::make_shared<Image>(words, entry);
+            image->fuse();
+            image->verify();
+
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = images.find(hash);
+            if (it != images.end()) {
+                return use(it);
+            }
+            ++misses;
+            images[hash] = {image, ++clock};
+            // Least recently used images go first
+            while (images.size() > capacity) {
+                auto oldest = images.begin();
+                for (auto candidate = images.begin(); candidate != images.end(); ++candidate) {
+                    if (candidate->second.lastUse < oldest->second.lastUse) {
+                        oldest = candidate;
+                    }
+                }
+                images.erase(oldest);
+            }
+            return image;
+        }
+
+        std::string stats() {
+            std::lock_guard<std::mutex> lock(mutex);
+            return "OK images " + std::to_string(images.size()) + " hits " + std::to_string(hits) +
+                   " misses " + std::to_string(misses);
+        }
+};
+
+// Limits applied to every run; requests may only lower the instruction limit
+struct Limits {
+    unsigned long maxInstructions = 0;
+    double timeout = 0;
+};
+
+static bool writeAll(int fd, std::string data) {
+    const char* next = data.data();
+    size_t size = data.size();
+    while (size > 0) {
+        ssize_t n = write(fd, next, size);
+        if (n <= 0) {
+            return false;
+        }
+        next += n;
+        size -= n;
+    }
+    return true;
+}
+
+// Reads one line (without its newline) from a socket, keeping what follows it in pending
+static bool readLine(int fd, std::string* pending, std::string* line) {
+    size_t newline;
+    while ((newline = pending->find('\n')) == std::string::npos) {
+        char chunk[4096];
+        ssize_t n = read(fd, chunk, sizeof(chunk));
+        if (n <= 0) {
+            return false;
+        }
+        pending->append(chunk, n);
+    }
+    *line = pending->substr(0, newline);
+    pending->erase(0, newline + 1);
+    return true;
+}
+
+static std::string run(std::istringstream& tokens, ImageCache& cache, Scheduler& scheduler, const Limits& limits) {
+    std::string path;
+    unsigned long maxInstructions;
+    size_t count;
+    if (!(tokens >> path >> maxInstructions >> count)) {
+        return "ERROR 1 0 malformed request";
+    }
+    std::vector<int> inputs;
+    int value;
+    while (inputs.size() < count && tokens >> value) {
+        inputs.push_back(value);
+    }
+    if (inputs.size() < count) {
+        return "ERROR 1 0 malformed request";
+    }
+
+    std::string errMsg;
+    auto image = cache.get(path, &errMsg);
+    if (!image) {
+        return "ERROR 1 0 " + errMsg;
+    }
+
+    Emulator emulator(image);
+    size_t next = 0;
+    emulator.setInputCallback([&](int* value) {
+        if (next >= inputs.size()) return false;
+        *value = inputs[next++];
+        return true;
+    });
+    std::vector<int> outputs;
+    emulator.setOutputCallback([&](int value) { outputs.push_back(value); });
+    if (limits.maxInstructions > 0 && (maxInstructions == 0 || maxInstructions > limits.maxInstructions)) {
+        maxInstructions = limits.maxInstructions;
+    }
+    if (maxInstructions > 0) {
+        emulator.setInstructionLimit(maxInstructions);
+    }
+    if (limits.timeout > 0) {
+        emulator.setTimeLimit(limits.timeout);
+    }
+
+    // Runs on the scheduler's workers, interleaved with the other connections' runs
+    std::mutex mutex;
+    std::condition_variable finished;
+    bool done = false;
+    scheduler.submit(&emulator, [&](Emulator*) {
+        std::lock_guard<std::mutex> lock(mutex);
+        done = true;
+        finished.notify_one();
+    });
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait(lock, [&]() { return done; });
+    }
+
+    std::string executed = std::to_string(emulator.getInstructionCount());
+    if (emulator.getError()) {
+        int status = emulator.getLimit() != Emulator::LIMIT_NONE ? LIMIT_STATUS[emulator.getLimit()] : 255;
+        return "ERROR " + std::to_string(status) + " " + executed + " " + emulator.getErrorMessage();
+    }
+    std::string response = "OK " + executed + " " + std::to_string(outputs.size());
+    for (int value : outputs) {
+        response += " " + std::to_string(value);
+    }
+    return response;
+}
+
+static void serve(int fd, ImageCache* cache, Scheduler* scheduler, Limits limits) {
+    std::string pending, line;
+    while (readLine(fd, &pending, &line)) {
+        std::istringstream tokens(line);
+        std::string command;
+        tokens >> command;
+        std::string response;
+        if (command == "RUN") {
+            response = run(tokens, *cache, *scheduler, limits);
+        } else if (command == "STATS") {
+            response = cache->stats();
+        } else {
+            response = "ERROR 1 0 unknown request " + command;
+        }
+        if (!writeAll(fd, response + "\n")) break;
+    }
+    close(fd);
+}
+
+static int connectTo(std::string socketName) {
+    struct sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (socketName.size() >= sizeof(addr.sun_path)) {
+        return -1;
+    }
+    std::strcpy(addr.sun_path, socketName.c_str());
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd >= 0 && connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Client mode: one RUN request, answered on stdout the way the emulador would
+static int request(std::string socketName, std::string imageName, unsigned long maxInstructions, std::vector<std::string> inputs) {
+    int fd = connectTo(socketName);
+    if (fd < 0) {
+        std::cout << "could not connect to " << socketName << std::endl;
+        return -1;
+    }
+    std::string line = "RUN " + imageName + " " + std::to_string(maxInstructions) + " " + std::to_string(inputs.size());
+    for (auto value : inputs) {
+        line += " " + value;
+    }
+    std::string pending, response;
+    if (!writeAll(fd, line + "\n") || !readLine(fd, &pending, &response)) {
+        std::cout << "connection to " << socketName << " lost" << std::endl;
+        close(fd);
+        return -1;
+    }
+    close(fd);
+
+    std::istringstream tokens(response);
+    std::string status;
+    unsigned long instructions;
+    tokens >> status;
+    if (status == "OK") {
+        size_t count;
+        tokens >> instructions >> count;
+        int value;
+        while (tokens >> value) {
+            std::cout << value << std::endl;
+        }
+        return 0;
+    }
+    int code = 1;
+    std::string message;
+    tokens >> code >> instructions;
+    std::getline(tokens >> std::ws, message);
+    std::cout << "simulation error: " << message << std::endl;
+    return code;
+}
+
+static char socketPath[sizeof(((struct sockaddr_un*)nullptr)->sun_path)];
+
+static void stopServer(int sig) {
+    unlink(socketPath);
+    signal(sig, SIG_DFL);
+    raise(sig);
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cout << "Missing arguments! Expecting at least 1:" << std::endl
+        << "Usage: servidor [-j <threads>] [--slice <instructions>] [--cache <images>] [--max-instructions <n>] [--timeout <seconds>] <socket>" << std::endl
+        << "       servidor -c <socket> [--max-instructions <n>] <executable-file> ...[inputs]" << std::endl;
+        return -1;
+    }
+
+    std::string socketName;
+    std::string clientImage;
+    std::vector<std::string> clientInputs;
+    bool client = false;
+    unsigned int nThreads = std::thread::hardware_concurrency();
+    unsigned long sliceSize = 100000;
+    size_t capacity = 64;
+    Limits limits;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = std::string(argv[i]);
+        if (arg == "-c" && i + 1 < argc) {
+            client = true;
+            socketName = argv[++i];
+        } else if (arg == "-j" && i + 1 < argc) {
+            nThreads = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--slice" && i + 1 < argc) {
+            sliceSize = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--cache" && i + 1 < argc) {
+            capacity = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--max-instructions" && i + 1 < argc) {
+            limits.maxInstructions = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--timeout" && i + 1 < argc) {
+            limits.timeout = std::strtod(argv[++i], nullptr);
+        } else if (client && clientImage.empty()) {
+            clientImage = isSuffix(arg, ".e") ? arg : arg + ".e";
+        } else if (client) {
+            clientInputs.push_back(arg);
+        } else {
+            socketName = arg;
+        }
+    }
+    if (client) {
+        return request(socketName, clientImage, limits.maxInstructions, clientInputs);
+    }
+    if (socketName.empty() || socketName.size() >= sizeof(socketPath) || sliceSize == 0 || capacity == 0) {
+        std::cout << "invalid socket name, slice or cache size" << std::endl;
+        return -1;
+    }
+
+    // Socket left over by a previous run is replaced
+    std::strcpy(socketPath, socketName.c_str());
+    unlink(socketPath);
+    struct sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    std::strcpy(addr.sun_path, socketPath);
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0 || bind(listener, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(listener, 64) != 0) {
+        std::cout << "could not listen on " << socketName << std::endl;
+        return -1;
+    }
+    signal(SIGPIPE, SIG_IGN);
+    for (int sig : {SIGINT, SIGTERM, SIGHUP}) {
+        signal(sig, stopServer);
+    }
+
+    ImageCache cache(capacity);
+    Scheduler scheduler(nThreads, sliceSize);
+    // Each connection gets a thread that parses its requests; the runs go to the scheduler
+    while (true) {
+        int fd = accept(listener, nullptr, nullptr);
+        if (fd < 0) continue;
+        std::thread(serve, fd, &cache, &scheduler, limits).detach();
+    }
+}
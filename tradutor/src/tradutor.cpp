@@ -0,0 +1,173 @@
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include <image.hpp>
+
+// C statement for ADD, SUB or MULT, wrapping like isa::add, isa::subtract and isa::multiply
+static std::string wrap(std::string op, unsigned int addr) {
+    return "acc = (int)((unsigned int)acc " + op + " (unsigned int)m[" + std::to_string(addr) + "]);";
+}
+
+// Errors are reported like the emulator does: after the output so far, on stdout, with status 255
+static std::string fail(unsigned int addr, std::string message) {
+    return "fail(" + std::to_string(addr) + ", \"" + message + "\");";
+}
+
+// Translates a verified image: every instruction gets a label, and control flow is plain gotos
+static void translate(const Image& image, std::ostream& out) {
+    const int* words = image.getWords();
+    unsigned int size = image.getSize();
+    auto code = image.getDecoded();
+
+    out << "#include <stdio.h>\n"
+        << "#include <stdlib.h>\n\n"
+        << "static int m[" << (size > 0 ? size : 1) << "] = {";
+    // Trailing zeros (the bss) are left to the static initialisation
+    unsigned int stored = size;
+    while (stored > 0 && words[stored - 1] == 0) {
+        --stored;
+    }
+    for (unsigned int addr = 0; addr < stored; ++addr) {
+        out << (addr % 16 == 0 ? "\n    " : " ") << words[addr] << ",";
+    }
+    out << "\n};\n\n"
+        << "static char inBuffer[1 << 16];\n"
+        << "static char outBuffer[1 << 16];\n\n"
+        // Same rule as isa::divide, which the interpreter uses
+        << "static int divide(int dividend, int divisor) {\n"
+        << "    return divisor == -1 ? (int)(0u - (unsigned int)dividend) : dividend / divisor;\n"
+        << "}\n\n"
+        << "static void fail(unsigned int addr, const char* message) {\n"
+        << "    printf(\"simulation error: address %u: %s\\n\", addr, message);\n"
+        << "    exit(255);\n"
+        << "}\n\n"
+        << "int main(void) {\n"
+        << "    int acc = 0;\n"
+        << "    setvbuf(stdin, inBuffer, _IOFBF, sizeof(inBuffer));\n"
+        << "    setvbuf(stdout, outBuffer, _IOFBF, sizeof(outBuffer));\n"
+        << "    goto L" << image.getEntry() << ";\n";
+
+    // Instructions that fall through are always followed by another one (verify() checks it)
+    for (unsigned int addr = 0; addr < size; ++addr) {
+        const Handlers::Decoded& entry = code[addr];
+        if (entry.handler == Handlers::UNDECODED) continue;
+        unsigned int a = entry.op[0];
+        unsigned int b = entry.op[1];
+        out << "L" << addr << ": ";
+        switch (entry.handler) {
+        case Handlers::ADD:
+            out << wrap("+", a);
+            break;
+        case Handlers::SUB:
+            out << wrap("-", a);
+            break;
+        case Handlers::MULT:
+            out << wrap("*", a);
+            break;
+        case Handlers::DIV:
+            out << "if (m[" << a << "] == 0) " << fail(addr, "division by zero")
+                << " acc = divide(acc, m[" << a << "]);";
+            break;
+        case Handlers::JMP:
+            out << "goto L" << a << ";";
+            break;
+        case Handlers::JMPN:
+            out << "if (acc < 0) goto L" << a << ";";
+            break;
+        case Handlers::JMPP:
+            out << "if (acc > 0) goto L" << a << ";";
+            break;
+        case Handlers::JMPZ:
+            out << "if (acc == 0) goto L" << a << ";";
+            break;
+        case Handlers::COPY:
+            out << "m[" << b << "] = m[" << a << "];";
+            break;
+        case Handlers::LOAD:
+            out << "acc = m[" << a << "];";
+            break;
+        case Handlers::STORE:
+            out << "m[" << a << "] = acc;";
+            break;
+        case Handlers::INPUT:
+            out << "if (scanf(\"%d\", &m[" << a << "]) != 1) " << fail(addr, "invalid input");
+            break;
+        case Handlers::OUTPUT:
+            out << "printf(\"%d\\n\", m[" << a << "]);";
+            break;
+        case Handlers::STOP:
+            out << "return 0;";
+            break;
+        }
+        out << "\n";
+    }
+    out << "    return 0;\n"
+        << "}\n";
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cout << "Missing arguments! Expecting 1:" << std::endl
+        << "Usage: tradutor [--c-only] [-o <output-executable>] <executable-file>" << std::endl;
+        return -1;
+    }
+
+    std::string fileName;
+    std::string outputName;
+    bool cOnly = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = std::string(argv[i]);
+        if (arg == "-o" && i + 1 < argc) {
+            outputName = argv[++i];
+        } else if (arg == "--c-only") {
+            cOnly = true;
+        } else {
+            fileName = arg;
+        }
+    }
+    // Executables may be given with or without their extension
+    if (isSuffix(fileName, ".e")) {
+        fileName = fileName.substr(0, fileName.size() - 2);
+    }
+    if (outputName.empty()) {
+        outputName = fileName + ".out";
+    }
+
+    auto image = std::make_shared<Image>(fileName + ".e");
+    if (image->getError()) {
+        std::cout << image->getErrorMessage() << std::endl;
+        return -1;
+    }
+    // Only images that never write into their code have a fixed control flow to translate
+    image->verify();
+    if (!image->isVerified()) {
+        std::cout << "cannot translate " << fileName << ".e: " << image->getUnverifiedReason() << std::endl
+                  << "run it with the emulador instead" << std::endl;
+        return -1;
+    }
+
+    std::string cName = fileName + ".c";
+    std::ofstream cFile(cName);
+    translate(*image, cFile);
+    cFile.close();
+    if (cFile.fail()) {
+        std::cout << "could not write " << cName << std::endl;
+        return -1;
+    }
+    if (cOnly) {
+        return 0;
+    }
+
+    // System C compiler, or the one in $CC
+    const char* cc = std::getenv("CC");
+    std::string command = std::string(cc && *cc ? cc : "cc") + " -O2 -o '" + outputName + "' '" + cName + "'";
+    if (std::system(command.c_str()) != 0) {
+        std::cout << "could not compile " << cName << std::endl;
+        return -1;
+    }
+
+    return 0;
+}